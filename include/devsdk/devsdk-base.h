@@ -68,7 +68,7 @@ typedef struct devsdk_commandresult
 {
   /** * The timestamp of the result. Should only be set if the device itself supplies one.  */
   uint64_t origin;
-  /** The result. */
+  /** The result. Arrays and binary values are retained by reference, not copied. */
   iot_data_t *value;
 } devsdk_commandresult;
 
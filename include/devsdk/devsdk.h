@@ -145,6 +145,47 @@ typedef bool (*devsdk_handle_get)
   iot_data_t **exception
 );
 
+/**
+ * @brief One device's part of a batched read.
+ */
+
+typedef struct devsdk_batch_request
+{
+  /** The details of the device to be queried */
+  const devsdk_device_t *device;
+  /** The number of readings requested */
+  uint32_t nreadings;
+  /** An array specifying the readings that have been requested */
+  const devsdk_commandrequest *requests;
+  /** An array in which to return the requested readings */
+  devsdk_commandresult *readings;
+  /** Set this to true if the readings for this device were obtained */
+  bool success;
+  /** Set this to an IOT_DATA_STRING to give more information if the readings for this device could not be obtained */
+  iot_data_t *exception;
+} devsdk_batch_request;
+
+/**
+ * @brief Callback issued to find which connection a device is reached through, for batching of reads.
+ * @param impl The context data passed in when the service was created.
+ * @param device The device. Its address will have been created.
+ * @return A key identifying the connection, or NULL if reads for this device should not be batched. The
+ *         string must remain valid for as long as the device address does.
+ */
+
+typedef const char * (*devsdk_connection_key) (void *impl, const devsdk_device_t *device);
+
+/**
+ * @brief Callback issued to read from several devices which share a connection. This is used for
+ *        autoevents which fall due together on devices with the same connection key.
+ * @param impl The context data passed in when the service was created.
+ * @param key The connection key, as returned by the connection key callback.
+ * @param nrequests The number of devices to be read.
+ * @param requests An array specifying the reads for each device, in which to return results.
+ */
+
+typedef void (*devsdk_handle_get_batch) (void *impl, const char *key, uint32_t nrequests, devsdk_batch_request *requests);
+
 /**
  * @brief Callback issued to handle PUT requests for setting device values.
  * @param impl The context data passed in when the service was created.
@@ -168,6 +209,71 @@ typedef bool (*devsdk_handle_put)
   iot_data_t **exception
 );
 
+/**
+ * @brief Completion handle for an asynchronous GET or PUT. The driver passes it to devsdk_async_complete()
+ *        when the operation has finished.
+ */
+
+typedef struct devsdk_async_t devsdk_async_t;
+
+/**
+ * @brief Callback issued to start a GET request for device readings without blocking. The arguments
+ *        other than the handle remain valid until the operation is completed.
+ * @param impl The context data passed in when the service was created.
+ * @param device The details of the device to be queried.
+ * @param nreadings The number of readings requested.
+ * @param requests An array specifying the readings that have been requested.
+ * @param readings An array in which to return the requested readings, before completing the operation.
+ * @param options Options which were set for this request.
+ * @param handle The handle with which to complete the operation.
+ * @param exception Set this to an IOT_DATA_STRING to give more information if the operation cannot be started.
+ * @return true if the operation was started, in which case it must be completed exactly once with
+ *         devsdk_async_complete(). false if it could not be started; the handle must then not be used.
+ *         A command waiting on the operation fails after Service/RequestTimeout, but the operation must
+ *         still be completed.
+ */
+
+typedef bool (*devsdk_handle_get_async)
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nreadings,
+  const devsdk_commandrequest *requests,
+  devsdk_commandresult *readings,
+  const iot_data_t *options,
+  devsdk_async_t *handle,
+  iot_data_t **exception
+);
+
+/**
+ * @brief Callback issued to start a PUT request without blocking. The arguments other than the handle
+ *        remain valid until the operation is completed.
+ * @param impl The context data passed in when the service was created.
+ * @param device The details of the device to be written.
+ * @param nvalues The number of set operations requested.
+ * @param requests An array specifying the resources to which to write.
+ * @param values An array specifying the values to be written.
+ * @param options Options which were set for this request.
+ * @param handle The handle with which to complete the operation.
+ * @param exception Set this to an IOT_DATA_STRING to give more information if the operation cannot be started.
+ * @return true if the operation was started, in which case it must be completed exactly once with
+ *         devsdk_async_complete(). false if it could not be started; the handle must then not be used.
+ *         A command waiting on the operation fails after Service/RequestTimeout, but the operation must
+ *         still be completed.
+ */
+
+typedef bool (*devsdk_handle_put_async)
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nvalues,
+  const devsdk_commandrequest *requests,
+  const iot_data_t *values[],
+  const iot_data_t *options,
+  devsdk_async_t *handle,
+  iot_data_t **exception
+);
+
 /**
  * @brief Callback issued during device service shutdown. The implementation should stop processing and release any resources that were being used.
  * @param impl The context data passed in when the service was created.
@@ -289,6 +395,20 @@ void devsdk_callbacks_set_listeners
 
 void devsdk_callbacks_set_autoevent_handlers (devsdk_callbacks *cb, devsdk_autoevent_start_handler ae_starter, devsdk_autoevent_stop_handler ae_stopper);
 
+/**
+ * @brief Populate optional batched read functions. If set, autoevents which fall due together are
+ *        grouped by connection key and read with a single call to the batch handler for each group.
+ */
+
+void devsdk_callbacks_set_batch_reader (devsdk_callbacks *cb, devsdk_connection_key conn_key, devsdk_handle_get_batch get_batch);
+
+/**
+ * @brief Populate optional asynchronous GET and PUT functions. Where set, these are used in place of the
+ *        blocking handlers passed to devsdk_callbacks_init() for REST and message bus commands and for autoevents.
+ */
+
+void devsdk_callbacks_set_async_handlers (devsdk_callbacks *cb, devsdk_handle_get_async get_async, devsdk_handle_put_async put_async);
+
 /**
  * @brief Populate optional device address validation function
  */
@@ -329,6 +449,76 @@ void devsdk_service_start (devsdk_service_t *svc, iot_data_t *driverdfls, devsdk
 
 void devsdk_post_readings (devsdk_service_t *svc, const char *device_name, const char *resource_name, devsdk_commandresult *values);
 
+/**
+ * @brief One Event in a call to devsdk_post_readings_batch().
+ */
+
+typedef struct devsdk_reading_batch
+{
+  /** The name of the device that the readings have come from */
+  const char *device_name;
+  /** Name of the resource or command which defines the Event */
+  const char *resource_name;
+  /** The readings, as for devsdk_post_readings() */
+  devsdk_commandresult *values;
+} devsdk_reading_batch;
+
+/**
+ * @brief Post several Events at once. This behaves as a series of calls to devsdk_post_readings(), but the
+ *        devices are looked up under a single lock acquisition and the Events are submitted together.
+ * @param svc The device service.
+ * @param n The number of entries in the batch.
+ * @param batch The Events to post. Entries naming an unknown device or resource are logged and skipped.
+ * @return The number of Events generated.
+ */
+
+uint32_t devsdk_post_readings_batch (devsdk_service_t *svc, uint32_t n, const devsdk_reading_batch *batch);
+
+/**
+ * @brief A device and resource resolved once for repeated posting of readings.
+ */
+
+typedef struct devsdk_reading_handle_t devsdk_reading_handle_t;
+
+/**
+ * @brief Create a handle for posting readings for a device resource. The device and resource need not exist yet;
+ *        they are looked up on first use, and again whenever devices or profiles change.
+ * @param svc The device service.
+ * @param device_name The name of the device that the readings will come from.
+ * @param resource_name Name of the resource or command which defines the Event.
+ * @return The new handle, to be freed with devsdk_reading_handle_free().
+ */
+
+devsdk_reading_handle_t *devsdk_reading_handle_new (devsdk_service_t *svc, const char *device_name, const char *resource_name);
+
+/**
+ * @brief Post readings through a handle. This behaves as devsdk_post_readings(), but avoids the lookups by name
+ *        on each call. A handle must not be used from more than one thread at a time.
+ * @param handle The handle.
+ * @param values An array of readings. These will be combined into an Event and submitted to core-data.
+ * @return true if an Event was generated.
+ */
+
+bool devsdk_reading_handle_post (devsdk_reading_handle_t *handle, devsdk_commandresult *values);
+
+/**
+ * @brief Free a handle created by devsdk_reading_handle_new().
+ * @param handle The handle.
+ */
+
+void devsdk_reading_handle_free (devsdk_reading_handle_t *handle);
+
+/**
+ * @brief Complete an asynchronous GET or PUT. This may be called from any thread, including from within
+ *        the callback which started the operation. The handle is invalid once this returns.
+ * @param handle The handle passed to the asynchronous handler.
+ * @param success Whether the operation succeeded. For a GET, the readings must have been populated if so.
+ * @param exception An IOT_DATA_STRING giving more information if the operation failed, or NULL. Ownership is
+ *        transferred to the SDK.
+ */
+
+void devsdk_async_complete (devsdk_async_t *handle, bool success, iot_data_t *exception);
+
 void devsdk_add_discovered_devices (devsdk_service_t *svc, uint32_t ndevices, devsdk_discovered_device *devices);
 
 /**
@@ -81,6 +81,7 @@ typedef struct edgex_devicecommand
 } edgex_devicecommand;
 
 struct edgex_cmdinfo;
+struct edgex_cmdindex;
 struct edgex_autoimpl;
 
 typedef struct edgex_deviceprofile
@@ -93,6 +94,8 @@ typedef struct edgex_deviceprofile
   edgex_deviceresource *device_resources;
   edgex_devicecommand *device_commands;
   struct edgex_cmdinfo *cmdinfo;
+  struct edgex_cmdindex *cmdindex;
+  atomic_uint_fast32_t refs;
   struct edgex_deviceprofile *next;
 } edgex_deviceprofile;
 
@@ -113,7 +116,11 @@ typedef struct edgex_device_autoevents
 {
   char *resource;
   char *interval;
+  uint64_t interval_ns;
   bool onChange;
+  double onChangeThreshold;        // absolute deadband for onChange
+  double onChangePercent;          // deadband as a percentage of the last published value
+  double onChangeHysteresis;       // added to the deadband when a change reverses direction
   struct edgex_autoimpl *impl;
   struct edgex_device_autoevents *next;
 } edgex_device_autoevents;
@@ -136,6 +143,8 @@ typedef struct edgex_device
   struct edgex_device *next;
   atomic_uint_fast32_t refs;
   atomic_int_fast32_t retries;
+  atomic_uint_fast64_t lastconnected;  // time of access not yet sent to core-metadata, zero if none
+  struct edgex_device *lcnext;         // next device with a pending lastConnected update
   bool ownprofile;
 } edgex_device;
 
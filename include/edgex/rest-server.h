@@ -12,6 +12,7 @@
 #include "edgex/edgex-base.h"
 #include "devsdk/devsdk-base.h"
 #include "iot/logger.h"
+#include <sys/types.h>
 
 #define CONTENT_JSON "application/json"
 #define CONTENT_CBOR "application/cbor"
@@ -48,11 +49,27 @@ typedef struct
   const char *authorization_header_value;
 } devsdk_http_request;
 
+/**
+ * @brief Produce part of a streamed reply body.
+ * @param ctx The stream_ctx of the reply.
+ * @param pos The offset within the body of the bytes required.
+ * @param buf The buffer to fill.
+ * @param max The size of buf.
+ * @return The number of bytes written to buf.
+ */
+
+typedef ssize_t (*devsdk_http_stream_fn) (void *ctx, uint64_t pos, char *buf, size_t max);
+
 typedef struct
 {
   int code;
   devsdk_http_data data;
   const char *content_type;
+  /** If set, the body of data.size bytes is produced by this function instead of being taken from data.bytes */
+  devsdk_http_stream_fn stream;
+  /** Called to release stream_ctx once the reply has been sent */
+  void (*stream_free) (void *ctx);
+  void *stream_ctx;
 } devsdk_http_reply;
 
 typedef void (*devsdk_http_handler_fn)
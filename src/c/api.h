@@ -20,6 +20,8 @@
 #define EDGEX_DEV_API3_DISCOVERY_DELETE "/api/v3/discovery/requestId/{requestId}"
 #define EDGEX_DEV_API3_CONFIG "/api/v3/config"
 #define EDGEX_DEV_API3_METRICS "/api/v3/metrics"
+#define EDGEX_DEV_API3_MEMORY "/api/v3/memory"
+#define EDGEX_DEV_API3_AUTOEVENTS "/api/v3/autoevents"
 #define EDGEX_DEV_API3_SECRET "/api/v3/secret"
 #define EDGEX_DEV_API3_DEVICE_NAME "/api/v3/device/name/{name}/{cmd}"
 
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+/* Asynchronous driver operations. A completion handle either carries a continuation, which is
+ * queued on the thread pool when the driver completes, or is waited on by the thread which
+ * started the operation. The latter lets REST and message bus commands, whose replies are
+ * produced synchronously, use drivers which only implement the asynchronous handlers.
+ *
+ * A waiting thread gives up after Service/RequestTimeout, so that a driver which never completes
+ * cannot hold a server thread indefinitely. To allow for this, a waited-on operation passes the
+ * driver its own copies of the results array, values and options: if the waiter has given up,
+ * these are freed when the driver eventually completes.
+ *
+ * The handle holds references on the device and on the profile the requests came from until the
+ * operation is finished with, so that the device details and the requests passed to the driver
+ * outlive a profile update or removal of the device while the driver is working.
+ */
+
+#include "async.h"
+#include "service.h"
+#include "devmap.h"
+#include "edgex-rest.h"
+#include "data.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+struct devsdk_async_t
+{
+  devsdk_service_t *svc;
+  edgex_device *dev;
+  edgex_deviceprofile *profile;
+  edgex_async_done done;           // NULL for a waited-on operation
+  void *ctx;
+  bool success;
+  iot_data_t *exception;
+  bool complete;
+  bool abandoned;                  // the waiter has timed out
+  devsdk_commandresult *results;   // held for a waited-on GET
+  uint32_t nresults;
+  iot_data_t **values;             // held for a waited-on PUT
+  uint32_t nvalues;
+  iot_data_t *params;
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+};
+
+static devsdk_async_t *async_alloc (devsdk_service_t *svc, edgex_device *dev, edgex_deviceprofile *profile, edgex_async_done done, void *ctx)
+{
+  devsdk_async_t *h = calloc (1, sizeof (devsdk_async_t));
+  h->svc = svc;
+  h->dev = dev;
+  atomic_fetch_add (&dev->refs, 1);
+  h->profile = profile;
+  edgex_deviceprofile_addref (profile);
+  h->done = done;
+  h->ctx = ctx;
+  if (done == NULL)
+  {
+    pthread_condattr_t attr;
+    pthread_mutex_init (&h->mtx, NULL);
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&h->cond, &attr);
+    pthread_condattr_destroy (&attr);
+  }
+  return h;
+}
+
+static void async_free (devsdk_async_t *h)
+{
+  edgex_deviceprofile_release (h->svc, h->profile);
+  edgex_device_release (h->svc, h->dev);
+  devsdk_commandresult_free (h->results, h->nresults);
+  for (uint32_t i = 0; i < h->nvalues; i++)
+  {
+    iot_data_free (h->values[i]);
+  }
+  free (h->values);
+  iot_data_free (h->params);
+  if (h->done == NULL)
+  {
+    pthread_cond_destroy (&h->cond);
+    pthread_mutex_destroy (&h->mtx);
+  }
+  free (h);
+}
+
+/* Wait for a driver to complete, for up to the request timeout. On completion any readings are moved to results
+   and the handle is freed. On timeout the handle is left for devsdk_async_complete to free */
+
+static bool async_wait (devsdk_async_t *h, devsdk_commandresult *results, iot_data_t **exception)
+{
+  uint64_t timeout = h->svc->config.service.timeout;
+  struct timespec ts;
+  int rc = 0;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  ts.tv_sec += timeout / 1000;
+  ts.tv_nsec += (timeout % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock (&h->mtx);
+  while (!h->complete && rc != ETIMEDOUT)
+  {
+    rc = timeout ? pthread_cond_timedwait (&h->cond, &h->mtx, &ts) : pthread_cond_wait (&h->cond, &h->mtx);
+  }
+  if (!h->complete)
+  {
+    h->abandoned = true;
+    pthread_mutex_unlock (&h->mtx);
+    iot_log_error (h->svc->logger, "Driver did not complete a request for device %s within %" PRIu64 "ms", h->dev->name, timeout);
+    *exception = iot_data_alloc_string ("Timed out waiting for the driver", IOT_DATA_REF);
+    return false;
+  }
+  pthread_mutex_unlock (&h->mtx);
+  bool result = h->success;
+  *exception = h->exception;
+  if (results)
+  {
+    memcpy (results, h->results, h->nresults * sizeof (devsdk_commandresult));
+    free (h->results);
+    h->results = NULL;
+    h->nresults = 0;
+  }
+  async_free (h);
+  return result;
+}
+
+static void *async_resume (void *p)
+{
+  devsdk_async_t *h = (devsdk_async_t *)p;
+  h->done (h->ctx, h->success, h->exception);
+  async_free (h);
+  return NULL;
+}
+
+void devsdk_async_complete (devsdk_async_t *h, bool success, iot_data_t *exception)
+{
+  h->success = success;
+  h->exception = exception;
+  if (h->done)
+  {
+    iot_threadpool_add_work (h->svc->thpool, async_resume, h, -1);
+  }
+  else
+  {
+    pthread_mutex_lock (&h->mtx);
+    bool abandoned = h->abandoned;
+    h->complete = true;
+    pthread_cond_signal (&h->cond);
+    pthread_mutex_unlock (&h->mtx);
+    if (abandoned)
+    {
+      iot_log_info (h->svc->logger, "Driver completed a timed-out request for device %s", h->dev->name);
+      iot_data_free (exception);
+      async_free (h);
+    }
+  }
+}
+
+bool edgex_device_get
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  devsdk_commandresult *results,
+  const iot_data_t *params,
+  iot_data_t **exception
+)
+{
+  if (svc->userfns.get_async)
+  {
+    devsdk_async_t *h = async_alloc (svc, dev, profile, NULL, NULL);
+    h->results = calloc (nreqs, sizeof (devsdk_commandresult));
+    h->nresults = nreqs;
+    h->params = params ? iot_data_add_ref (params) : NULL;
+    if (svc->userfns.get_async (svc->userdata, dev->devimpl, nreqs, reqs, h->results, h->params, h, exception))
+    {
+      return async_wait (h, results, exception);
+    }
+    async_free (h);
+    return false;
+  }
+  return svc->userfns.gethandler (svc->userdata, dev->devimpl, nreqs, reqs, results, params, exception);
+}
+
+bool edgex_device_put
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  const iot_data_t **values,
+  const iot_data_t *params,
+  iot_data_t **exception
+)
+{
+  if (svc->userfns.put_async)
+  {
+    devsdk_async_t *h = async_alloc (svc, dev, profile, NULL, NULL);
+    h->values = malloc (nreqs * sizeof (iot_data_t *));
+    for (uint32_t i = 0; i < nreqs; i++)
+    {
+      h->values[i] = values[i] ? iot_data_add_ref (values[i]) : NULL;
+    }
+    h->nvalues = nreqs;
+    h->params = params ? iot_data_add_ref (params) : NULL;
+    if (svc->userfns.put_async (svc->userdata, dev->devimpl, nreqs, reqs, (const iot_data_t **)h->values, h->params, h, exception))
+    {
+      return async_wait (h, NULL, exception);
+    }
+    async_free (h);
+    return false;
+  }
+  return svc->userfns.puthandler (svc->userdata, dev->devimpl, nreqs, reqs, values, params, exception);
+}
+
+bool edgex_device_get_async
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  devsdk_commandresult *results,
+  edgex_async_done done,
+  void *ctx,
+  iot_data_t **exception
+)
+{
+  devsdk_async_t *h = async_alloc (svc, dev, profile, done, ctx);
+  if (svc->userfns.get_async (svc->userdata, dev->devimpl, nreqs, reqs, results, NULL, h, exception))
+  {
+    return true;
+  }
+  async_free (h);
+  return false;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef _EDGEX_DEVICE_ASYNC_H_
+#define _EDGEX_DEVICE_ASYNC_H_ 1
+
+#include "devsdk/devsdk.h"
+#include "edgex/edgex.h"
+
+/* Continuation run on the thread pool when an asynchronous operation completes. Takes ownership of exception */
+
+typedef void (*edgex_async_done) (void *ctx, bool success, iot_data_t *exception);
+
+/* Run a GET or PUT through the driver, using its asynchronous handler if it has one and waiting for completion.
+ * The requests belong to profile, on which the caller holds a reference for the duration of the call.
+ */
+
+extern bool edgex_device_get
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  devsdk_commandresult *results,
+  const iot_data_t *params,
+  iot_data_t **exception
+);
+
+extern bool edgex_device_put
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  const iot_data_t **values,
+  const iot_data_t *params,
+  iot_data_t **exception
+);
+
+/* Start a GET through the driver's asynchronous handler, which must be set. If it returns true, done will be
+ * called on the thread pool when the driver completes. Otherwise the operation could not be started.
+ */
+
+extern bool edgex_device_get_async
+(
+  devsdk_service_t *svc,
+  edgex_device *dev,
+  edgex_deviceprofile *profile,
+  uint32_t nreqs,
+  const devsdk_commandrequest *reqs,
+  devsdk_commandresult *results,
+  edgex_async_done done,
+  void *ctx,
+  iot_data_t **exception
+);
+
+#endif
@@ -15,143 +15,992 @@
 #include "devutil.h"
 #include "correlation.h"
 #include "metadata.h"
+#include "lastconnected.h"
 #include "data.h"
 #include "opstate.h"
+#include "intern.h"
+#include "map.h"
+#include "async.h"
 
 #include <microhttpd.h>
+#include <time.h>
+
+/* SDK-scheduled autoevents run from a hashed timer wheel rather than from one iot_schedule
+ * each. A wheel thread advances one slot per tick; autoevents due in that tick are collected
+ * and handed to the thread pool in batches, so a large fleet with common intervals costs a
+ * handful of pool jobs per tick rather than one per autoevent. Intervals are rounded to the
+ * tick; autoevents due further ahead than one revolution stay in their slot until their tick.
+ * Where the driver reads in batches, the tick's autoevents are grouped by connection key first.
+ *
+ * To avoid every autoevent with the same interval firing on the same tick, the first firing
+ * may be offset within the interval (Device/AutoEvents/Phase) and each firing may be delayed
+ * by a random jitter (Device/AutoEvents/Jitter). Jitter does not accumulate: the schedule is
+ * kept in terms of an undisturbed base tick.
+ *
+ * Reads of one autoevent never overlap. An autoevent whose previous read is still queued or
+ * running when it falls due is skipped for that tick, or with Device/AutoEvents/Overrun set to
+ * Queue, has one further read queued behind it. Reads which fail double the interval, up to Device/AutoEvents/MaxBackoff times the
+ * configured one, and reads slower than the interval stretch it to cover their duration.
+ */
+
+#define AE_WHEEL_SLOTS 1024
+#define AE_WHEEL_TICK IOT_MS_TO_NS (10)
+#define AE_BATCH_JOBS 8
+#define AE_BATCH_MAX 64
+#define AE_LOAD_SHIFT 6           // smoothing factor of 1/64 per tick for the load average
+#define AE_LATENCY_SHIFT 2        // smoothing factor of 1/4 per read for the read latency
+#define AE_GOLDEN 0x9E3779B97F4A7C15ull
+
+/* In-flight states of an autoevent */
+#define AE_IDLE 0u
+#define AE_RUNNING 1u
+#define AE_REQUEUED 2u
+
+/* For onChange autoevents the last published value of each reading is kept in a typed slot.
+ * Numeric values are held as plain numbers so that a deadband can be applied; other values
+ * are held by reference.
+ */
+
+typedef struct edgex_aeslot
+{
+  iot_data_type_t type;
+  int dir;                         // direction of the last published change: -1, 0 or 1
+  union
+  {
+    int64_t i;
+    uint64_t u;
+    double f;
+    bool b;
+    iot_data_t *other;
+  } v;
+} edgex_aeslot;
 
 typedef struct edgex_autoimpl
 {
   devsdk_service_t *svc;
-  devsdk_commandresult *last;
-  uint64_t interval;
+  edgex_aeslot *last;              // nreqs slots for the last published readings, then nreqs for the current ones
+  bool primed;                     // last holds a published value
+  uint64_t interval;               // nanoseconds
   const edgex_cmdinfo *resource;
-  char *device;
-  devsdk_protocols *protocols;
+  edgex_deviceprofile *profile;    // holds a reference, keeping resource valid
+  unsigned nreqs;
+  char *device;                    // interned
+  devsdk_protocols *protocols;     // only held for driver-managed autoevents
   void *handle;
   bool onChange;
+  double threshold;
+  double percent;
+  double hysteresis;
+  atomic_uint refs;
+  atomic_uint inflight;            // AE_IDLE, AE_RUNNING or AE_REQUEUED
+  atomic_uint stretch;             // multiple of the period to the next firing
+  unsigned fails;                  // consecutive failed reads
+  uint64_t latency;                // smoothed read time, nanoseconds
+  atomic_uint_fast64_t overruns;
+  atomic_uint_fast64_t skipped;
+  atomic_uint_fast64_t maxruntime; // nanoseconds
+  struct edgex_autoimpl *wnext;    // wheel slot list, protected by the wheel lock
+  struct edgex_autoimpl **wpprev;
+  uint64_t base;                   // ticks, due time before jitter
+  uint64_t due;                    // ticks
+  uint64_t period;                 // ticks
 } edgex_autoimpl;
 
-static void edgex_autoimpl_release (void *p)
+struct edgex_aewheel
 {
-  edgex_autoimpl *ai = (edgex_autoimpl *)p;
-  free (ai->device);
-  devsdk_protocols_free (ai->protocols);
-  devsdk_commandresult_free (ai->last, ai->resource->nreqs);
-  free (ai);
+  devsdk_service_t *svc;
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  pthread_t thread;
+  bool running;
+  uint64_t start;
+  uint64_t tick;
+  unsigned seed;
+  edgex_map_int stagger;           // autoevents started per period, for staggering
+  uint64_t load;                   // smoothed autoevents per tick, fixed point with 16 fractional bits
+  unsigned peak;                   // most autoevents in a tick since the load was last read
+  edgex_autoimpl *slots[AE_WHEEL_SLOTS];
+};
+
+typedef struct edgex_aebatch
+{
+  unsigned n;
+  edgex_autoimpl *ais[];
+} edgex_aebatch;
+
+static bool ae_slot_held (iot_data_type_t type)
+{
+  switch (type)
+  {
+    case IOT_DATA_INT8: case IOT_DATA_INT16: case IOT_DATA_INT32: case IOT_DATA_INT64:
+    case IOT_DATA_UINT8: case IOT_DATA_UINT16: case IOT_DATA_UINT32: case IOT_DATA_UINT64:
+    case IOT_DATA_FLOAT32: case IOT_DATA_FLOAT64: case IOT_DATA_BOOL: case IOT_DATA_INVALID:
+      return false;
+    default:
+      return true;
+  }
 }
 
-static void *ae_runner (void *p)
+static void ae_slot_clear (edgex_aeslot *s)
 {
-  edgex_autoimpl *ai = (edgex_autoimpl *)p;
+  if (ae_slot_held (s->type))
+  {
+    iot_data_free (s->v.other);
+  }
+  s->type = IOT_DATA_INVALID;
+}
+
+static void ae_slot_set (edgex_aeslot *s, const iot_data_t *val)
+{
+  ae_slot_clear (s);
+  if (val == NULL)
+  {
+    return;
+  }
+  s->type = iot_data_type (val);
+  switch (s->type)
+  {
+    case IOT_DATA_INT8: case IOT_DATA_INT16: case IOT_DATA_INT32: case IOT_DATA_INT64:
+    case IOT_DATA_UINT8: case IOT_DATA_UINT16: case IOT_DATA_UINT32:
+      iot_data_cast (val, IOT_DATA_INT64, &s->v.i);
+      break;
+    case IOT_DATA_UINT64:
+      s->v.u = iot_data_ui64 (val);
+      break;
+    case IOT_DATA_FLOAT32: case IOT_DATA_FLOAT64:
+      iot_data_cast (val, IOT_DATA_FLOAT64, &s->v.f);
+      break;
+    case IOT_DATA_BOOL:
+      s->v.b = iot_data_bool (val);
+      break;
+    default:
+      s->v.other = iot_data_add_ref (val);
+      break;
+  }
+}
+
+static double ae_slot_number (const edgex_aeslot *s)
+{
+  switch (s->type)
+  {
+    case IOT_DATA_FLOAT32: case IOT_DATA_FLOAT64: return s->v.f;
+    case IOT_DATA_UINT64: return (double)s->v.u;
+    default: return (double)s->v.i;
+  }
+}
+
+static void ae_slots_free (edgex_aeslot *slots, unsigned n)
+{
+  if (slots)
+  {
+    for (unsigned i = 0; i < n; i++)
+    {
+      ae_slot_clear (&slots[i]);
+    }
+    free (slots);
+  }
+}
+
+static void edgex_autoimpl_release (edgex_autoimpl *ai)
+{
+  if (atomic_fetch_sub (&ai->refs, 1) == 1)
+  {
+    edgex_intern_release (ai->device);
+    devsdk_protocols_free (ai->protocols);
+    ae_slots_free (ai->last, 2 * ai->nreqs);
+    edgex_deviceprofile_release (ai->svc, ai->profile);
+    free (ai);
+  }
+}
+
+static uint64_t monotime (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return IOT_SEC_TO_NS ((uint64_t)ts.tv_sec) + ts.tv_nsec;
+}
+
+static void wheel_link (edgex_aewheel *w, edgex_autoimpl *ai)
+{
+  edgex_autoimpl **slot = &w->slots[ai->due & (AE_WHEEL_SLOTS - 1)];
+  ai->wnext = *slot;
+  if (*slot)
+  {
+    (*slot)->wpprev = &ai->wnext;
+  }
+  ai->wpprev = slot;
+  *slot = ai;
+}
+
+static void wheel_unlink (edgex_autoimpl *ai)
+{
+  *ai->wpprev = ai->wnext;
+  if (ai->wnext)
+  {
+    ai->wnext->wpprev = ai->wpprev;
+  }
+  ai->wpprev = NULL;
+  ai->wnext = NULL;
+}
+
+static uint64_t phase_hash (const char *devname, const char *resname)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (const char *s = devname; *s; s++)
+  {
+    h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+  }
+  h = (h ^ '/') * 0x100000001b3ull;
+  for (const char *s = resname; *s; s++)
+  {
+    h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+/* Offset of the first firing within the interval, in ticks. Staggered autoevents of a given
+ * period take successive points of the golden ratio sequence, which stays evenly spread however
+ * many of them there turn out to be. Called with the wheel lock held.
+ */
+
+static uint64_t wheel_phase (edgex_aewheel *w, const edgex_autoimpl *ai)
+{
+  uint64_t h;
+  switch (ai->svc->config.device.aephase)
+  {
+    case EDGEX_AE_PHASE_HASH:
+      h = phase_hash (ai->device, ai->resource->name);
+      break;
+    case EDGEX_AE_PHASE_STAGGER:
+    {
+      char key[24];
+      snprintf (key, sizeof (key), "%" PRIu64, ai->period);
+      int *count = edgex_map_get (&w->stagger, key);
+      int n = count ? *count : 0;
+      edgex_map_set (&w->stagger, key, n + 1);
+      h = (uint64_t)n * AE_GOLDEN;
+      break;
+    }
+    default:
+      return ai->period - 1;
+  }
+  /* Scale the top 32 bits into [0, period) */
+  return ((h >> 32) * ai->period) >> 32;
+}
+
+static uint64_t wheel_jitter (edgex_aewheel *w, const edgex_autoimpl *ai)
+{
+  uint64_t max = IOT_MS_TO_NS (ai->svc->config.device.aejitter) / AE_WHEEL_TICK;
+  if (max >= ai->period)
+  {
+    max = ai->period - 1;
+  }
+  return max ? (uint64_t)rand_r (&w->seed) % (max + 1) : 0;
+}
+
+/* The wheel holds a reference on each autoevent linked into it */
+
+static void wheel_add (edgex_aewheel *w, edgex_autoimpl *ai)
+{
+  ai->period = (ai->interval + AE_WHEEL_TICK / 2) / AE_WHEEL_TICK;
+  if (ai->period == 0)
+  {
+    ai->period = 1;
+  }
+  pthread_mutex_lock (&w->mtx);
+  if (ai->wpprev == NULL)
+  {
+    atomic_fetch_add (&ai->refs, 1);
+    ai->base = w->tick + 1 + wheel_phase (w, ai);
+    ai->due = ai->base + wheel_jitter (w, ai);
+    wheel_link (w, ai);
+  }
+  pthread_mutex_unlock (&w->mtx);
+}
+
+/* Take an autoevent off the wheel, dropping the wheel's reference. Returns false if it was not on the wheel */
+
+static bool wheel_remove (edgex_aewheel *w, edgex_autoimpl *ai)
+{
+  bool linked;
+  pthread_mutex_lock (&w->mtx);
+  linked = (ai->wpprev != NULL);
+  if (linked)
+  {
+    wheel_unlink (ai);
+  }
+  pthread_mutex_unlock (&w->mtx);
+  if (linked)
+  {
+    edgex_autoimpl_release (ai);
+  }
+  return linked;
+}
+
+/* Mark an autoevent as having a read in flight. Returns false if it already had one; in Queue
+ * mode a second read is then requested of the running job, if not already requested.
+ */
+
+static bool wheel_claim (edgex_aewheel *w, edgex_autoimpl *ai)
+{
+  unsigned state = AE_IDLE;
+  if (atomic_compare_exchange_strong (&ai->inflight, &state, AE_RUNNING))
+  {
+    return true;
+  }
+  if (!(state == AE_RUNNING && w->svc->config.device.aequeue && atomic_compare_exchange_strong (&ai->inflight, &state, AE_REQUEUED)))
+  {
+    atomic_fetch_add (&ai->skipped, 1);
+    atomic_fetch_add (&w->svc->metrics.aeskip, 1);
+  }
+  return false;
+}
+
+/* Called when a read has finished. Returns true if another was queued behind it */
+
+static bool ae_complete (edgex_autoimpl *ai)
+{
+  return atomic_fetch_sub (&ai->inflight, 1) == AE_REQUEUED;
+}
+
+static void ae_log_exception (devsdk_service_t *svc, iot_data_t *exc)
+{
+  if (exc)
+  {
+    char *errstr = iot_data_to_json (exc);
+    iot_log_error (svc->logger, "%s", errstr);
+    iot_data_free (exc);
+    free (errstr);
+  }
+}
+
+/* Look up the device for an autoevent. Returns NULL if it is gone, or should not be read now */
 
+static edgex_device *ae_acquire (edgex_autoimpl *ai)
+{
   edgex_device *dev = edgex_devmap_device_byname (ai->svc->devices, ai->device);
-  if (dev)
+  if (dev == NULL)
+  {
+    iot_log_error
+      (ai->svc->logger, "Autoevent fired for unknown device %s", ai->device);
+    wheel_remove (ai->svc->aewheel, ai);
+  }
+  else if (ai->svc->adminstate == LOCKED || dev->adminState == LOCKED || dev->operatingState == DOWN)
+  {
+    edgex_device_release (ai->svc, dev);
+    dev = NULL;
+  }
+  return dev;
+}
+
+static bool ae_address (edgex_autoimpl *ai, edgex_device *dev)
+{
+  iot_data_t *exc = NULL;
+  if (dev->devimpl->address == NULL)
   {
-    if (ai->svc->adminstate == LOCKED || dev->adminState == LOCKED || dev->operatingState == DOWN)
+    dev->devimpl->address = ai->svc->userfns.create_addr (ai->svc->userdata, dev->protocols, &exc);
+  }
+  if (dev->devimpl->address == NULL)
+  {
+    iot_log_error (ai->svc->logger, "AutoEvent: Address parsing for %s failed", dev->name);
+  }
+  ae_log_exception (ai->svc, exc);
+  return dev->devimpl->address != NULL;
+}
+
+/* Decide whether an onChange autoevent should publish. A numeric reading has changed if it has
+ * moved from the last published value by more than the deadband: the larger of the absolute
+ * threshold and the percentage of that value, widened by the hysteresis if the movement is in
+ * the opposite direction to the last published change. With no deadband any difference counts.
+ * The new values are captured before the event is built, as transforms modify the results.
+ */
+
+static bool ae_changed (edgex_autoimpl *ai, const devsdk_commandresult *results)
+{
+  unsigned n = ai->resource->nreqs;
+  bool changed = !ai->primed;
+  if (ai->last == NULL)
+  {
+    ai->last = calloc (2 * n, sizeof (edgex_aeslot));
+    for (unsigned i = 0; i < 2 * n; i++)
     {
-      edgex_device_release (ai->svc, dev);
-      return NULL;
+      ai->last[i].type = IOT_DATA_INVALID;
     }
-    edgex_device_alloc_crlid (NULL);
-    iot_log_info (ai->svc->logger, "AutoEvent: %s/%s", ai->device, ai->resource->name);
-    devsdk_commandresult *results = calloc (ai->resource->nreqs, sizeof (devsdk_commandresult));
-    iot_data_t *exc = NULL;
-    if (dev->devimpl->address == NULL)
+  }
+  for (unsigned i = 0; i < n; i++)
+  {
+    const edgex_aeslot *prev = &ai->last[i];
+    edgex_aeslot *cur = &ai->last[n + i];
+    ae_slot_set (cur, results[i].value);
+    cur->dir = prev->dir;
+    if (!ai->primed || cur->type != prev->type)
     {
-      dev->devimpl->address = ai->svc->userfns.create_addr (ai->svc->userdata, dev->protocols, &exc);
+      changed = true;
+      continue;
     }
-    if (dev->devimpl->address)
+    switch (cur->type)
     {
-      if (ai->svc->userfns.gethandler (ai->svc->userdata, dev->devimpl, ai->resource->nreqs, ai->resource->reqs, results, NULL, &exc))
+      case IOT_DATA_INVALID:
+        break;
+      case IOT_DATA_BOOL:
+        changed |= (cur->v.b != prev->v.b);
+        break;
+      case IOT_DATA_INT8: case IOT_DATA_INT16: case IOT_DATA_INT32: case IOT_DATA_INT64:
+      case IOT_DATA_UINT8: case IOT_DATA_UINT16: case IOT_DATA_UINT32: case IOT_DATA_UINT64:
+      case IOT_DATA_FLOAT32: case IOT_DATA_FLOAT64:
       {
-        devsdk_commandresult *resdup = NULL;
-        if (!(ai->onChange && ai->last && devsdk_commandresult_equal (results, ai->last, ai->resource->nreqs)))
+        double was = ae_slot_number (prev);
+        double delta = ae_slot_number (cur) - was;
+        int dir = (delta > 0) - (delta < 0);
+        double band = ai->percent * (was < 0 ? -was : was) / 100.0;
+        if (band < ai->threshold)
+        {
+          band = ai->threshold;
+        }
+        if (dir && prev->dir && dir != prev->dir)
+        {
+          band += ai->hysteresis;
+        }
+        bool moved = band > 0.0 ? (delta > band || delta < -band) :
+          (cur->type == IOT_DATA_FLOAT32 || cur->type == IOT_DATA_FLOAT64) ? cur->v.f != prev->v.f : cur->v.i != prev->v.i;
+        if (moved)
         {
-          devsdk_error err = EDGEX_OK;
-          if (ai->onChange)
-          {
-            resdup = devsdk_commandresult_dup (results, ai->resource->nreqs);
-          }
-          edgex_event_cooked *event =
-            edgex_data_process_event (dev->name, ai->resource, results, ai->svc->config.device.datatransform);
-          if (event)
-          {
-            if (ai->svc->config.device.maxeventsize && edgex_event_cooked_size (event) > ai->svc->config.device.maxeventsize * 1024)
-            {
-              iot_log_error (ai->svc->logger, "Auto Event size (%zu KiB) exceeds configured MaxEventSize", edgex_event_cooked_size (event) / 1024);
-            }
-            else
-            {
-              edgex_data_client_add_event (ai->svc->msgbus, event, &ai->svc->metrics);
-            }
-            edgex_event_cooked_free (event);
-            if (ai->onChange)
-            {
-              devsdk_commandresult_free (ai->last, ai->resource->nreqs);
-              ai->last = resdup;
-              resdup = NULL;
-            }
-            if (ai->svc->config.device.updatelastconnected)
-            {
-              edgex_metadata_client_update_lastconnected (ai->svc->logger, &ai->svc->config.endpoints, ai->svc->secretstore, dev->name, &err);
-            }
-            devsdk_device_request_succeeded (ai->svc, dev);
-          }
-          else
-          {
-            iot_log_error (ai->svc->logger, "Assertion failed for device %s. Disabling.", dev->name);
-            edgex_metadata_client_set_device_opstate
-              (ai->svc->logger, &ai->svc->config.endpoints, ai->svc->secretstore, dev->name, DOWN, &err);
-          }
+          cur->dir = dir;
+          changed = true;
+        }
+        break;
+      }
+      default:
+        changed |= !iot_data_equal (cur->v.other, prev->v.other);
+        break;
+    }
+  }
+  return changed;
+}
+
+/* Make the captured values the last published ones */
+
+static void ae_publish (edgex_autoimpl *ai)
+{
+  unsigned n = ai->resource->nreqs;
+  for (unsigned i = 0; i < n; i++)
+  {
+    ae_slot_clear (&ai->last[i]);
+    ai->last[i] = ai->last[n + i];
+    ai->last[n + i].type = IOT_DATA_INVALID;
+  }
+  ai->primed = true;
+}
+
+/* Deal with the outcome of a read: post an event if required, and update the device's state. Takes ownership of results and exc */
+
+static void ae_process (edgex_autoimpl *ai, edgex_device *dev, bool ok, devsdk_commandresult *results, iot_data_t *exc)
+{
+  if (ok)
+  {
+    if (!ai->onChange || ae_changed (ai, results))
+    {
+      edgex_event_cooked *event =
+        edgex_data_process_event (dev->name, ai->resource, results, ai->svc->config.device.datatransform);
+      if (event)
+      {
+        if (ai->svc->config.device.maxeventsize && edgex_event_cooked_size (event) > ai->svc->config.device.maxeventsize * 1024)
+        {
+          iot_log_error (ai->svc->logger, "Auto Event size (%zu KiB) exceeds configured MaxEventSize", edgex_event_cooked_size (event) / 1024);
         }
         else
         {
-          devsdk_device_request_succeeded (ai->svc, dev);
+          edgex_data_client_add_event (ai->svc->msgbus, event, &ai->svc->metrics);
+        }
+        edgex_event_cooked_free (event);
+        if (ai->onChange)
+        {
+          ae_publish (ai);
+        }
+        if (ai->svc->config.device.updatelastconnected)
+        {
+          edgex_lcwriter_note (ai->svc->lcwriter, dev);
         }
-        devsdk_commandresult_free (resdup, ai->resource->nreqs);
+        devsdk_device_request_succeeded (ai->svc, dev);
       }
       else
       {
-        iot_log_error (ai->svc->logger, "AutoEvent: Driver for %s failed on GET", dev->name);
-        devsdk_device_request_failed (ai->svc, dev);
+        iot_log_error (ai->svc->logger, "Assertion failed for device %s. Disabling.", dev->name);
+        devsdk_queue_device_opstate (ai->svc, dev->name, false);
       }
     }
     else
     {
-      iot_log_error (ai->svc->logger, "AutoEvent: Address parsing for %s failed", dev->name);
+      devsdk_device_request_succeeded (ai->svc, dev);
     }
-    if (exc)
+  }
+  else
+  {
+    iot_log_error (ai->svc->logger, "AutoEvent: Driver for %s failed on GET", dev->name);
+    devsdk_device_request_failed (ai->svc, dev);
+  }
+  ae_log_exception (ai->svc, exc);
+  devsdk_commandresult_free (results, ai->resource->nreqs);
+}
+
+/* Track the outcome and duration of a read, and set the interval multiple for the next firing */
+
+static void ae_account (edgex_autoimpl *ai, bool ok, uint64_t elapsed)
+{
+  unsigned max = ai->svc->config.device.aebackoff;
+  unsigned stretch = 1;
+
+  if (elapsed > ai->interval)
+  {
+    atomic_fetch_add (&ai->overruns, 1);
+    atomic_fetch_add (&ai->svc->metrics.aeoverrun, 1);
+  }
+  if (elapsed > atomic_load (&ai->maxruntime))
+  {
+    atomic_store (&ai->maxruntime, elapsed);
+  }
+  ai->latency = ai->latency ? ai->latency + (elapsed >> AE_LATENCY_SHIFT) - (ai->latency >> AE_LATENCY_SHIFT) : elapsed;
+  if (ok)
+  {
+    ai->fails = 0;
+  }
+  else if (ai->fails < 31)
+  {
+    ai->fails++;
+  }
+  if (ai->fails)
+  {
+    stretch = (ai->fails < 31 && (1u << ai->fails) < max) ? 1u << ai->fails : max;
+  }
+  if (ai->latency > ai->interval)
+  {
+    uint64_t cover = (ai->latency + ai->interval - 1) / ai->interval;
+    if (cover > stretch)
     {
-      char *errstr = iot_data_to_json (exc);
-      iot_log_error (ai->svc->logger, "%s", errstr);
-      iot_data_free (exc);
-      free (errstr);
+      stretch = cover < max ? (unsigned)cover : max;
     }
-    devsdk_commandresult_free (results, ai->resource->nreqs);
-    edgex_device_free_crlid ();
-    edgex_device_release (ai->svc, dev);
+  }
+  if (atomic_exchange (&ai->stretch, stretch) != stretch)
+  {
+    if (stretch > 1)
+    {
+      iot_log_warn (ai->svc->logger, "AutoEvent: %s/%s backing off to %u times its interval", ai->device, ai->resource->name, stretch);
+    }
+    else
+    {
+      iot_log_info (ai->svc->logger, "AutoEvent: %s/%s restored to its interval", ai->device, ai->resource->name);
+    }
+  }
+}
+
+static void *ae_runner (void *p);
+
+/* A read of an autoevent has finished. The caller's reference passes to a further read if one was queued */
+
+static void ae_finish (edgex_autoimpl *ai)
+{
+  if (ae_complete (ai))
+  {
+    iot_threadpool_add_work (ai->svc->thpool, ae_runner, ai, -1);
   }
   else
   {
-    iot_log_error
-      (ai->svc->logger, "Autoevent fired for unknown device %s", ai->device);
-    if (ai->handle)
+    edgex_autoimpl_release (ai);
+  }
+}
+
+/* State of a read in progress through the driver's asynchronous handler */
+
+typedef struct ae_async
+{
+  edgex_autoimpl *ai;
+  edgex_device *dev;
+  devsdk_commandresult *results;
+  uint64_t start;
+  char *crlid;
+} ae_async;
+
+static void ae_async_done (void *ctx, bool ok, iot_data_t *exc)
+{
+  ae_async *op = (ae_async *)ctx;
+  edgex_autoimpl *ai = op->ai;
+  edgex_device_alloc_crlid (op->crlid);
+  ae_account (ai, ok, monotime () - op->start);
+  ae_process (ai, op->dev, ok, op->results, exc);
+  edgex_device_free_crlid ();
+  edgex_device_release (ai->svc, op->dev);
+  free (op->crlid);
+  free (op);
+  ae_finish (ai);
+}
+
+/* Read an autoevent's resource. Returns true if the read is continuing asynchronously, in which case
+ * the device reference and the caller's reference on the autoevent have been taken over, and
+ * ae_finish will be called when the driver completes.
+ */
+
+static bool ae_read (edgex_autoimpl *ai, edgex_device *dev)
+{
+  bool pending = false;
+  edgex_device_alloc_crlid (NULL);
+  iot_log_info (ai->svc->logger, "AutoEvent: %s/%s", ai->device, ai->resource->name);
+  if (ae_address (ai, dev))
+  {
+    iot_data_t *exc = NULL;
+    devsdk_commandresult *results = calloc (ai->resource->nreqs, sizeof (devsdk_commandresult));
+    uint64_t start = monotime ();
+    bool ok;
+    if (ai->svc->userfns.get_async)
+    {
+      ae_async *op = malloc (sizeof (ae_async));
+      op->ai = ai;
+      op->dev = dev;
+      op->results = results;
+      op->start = start;
+      op->crlid = strdup (edgex_device_get_crlid ());
+      pending = edgex_device_get_async (ai->svc, dev, ai->profile, ai->resource->nreqs, ai->resource->reqs, results, ae_async_done, op, &exc);
+      if (!pending)
+      {
+        free (op->crlid);
+        free (op);
+      }
+      ok = false;
+    }
+    else
+    {
+      ok = ai->svc->userfns.gethandler (ai->svc->userdata, dev->devimpl, ai->resource->nreqs, ai->resource->reqs, results, NULL, &exc);
+    }
+    if (!pending)
+    {
+      ae_account (ai, ok, monotime () - start);
+      ae_process (ai, dev, ok, results, exc);
+    }
+  }
+  else
+  {
+    ae_account (ai, false, 0);
+  }
+  edgex_device_free_crlid ();
+  return pending;
+}
+
+/* Run one read of an autoevent. Holds a reference on it, and its in-flight state */
+
+static void *ae_runner (void *p)
+{
+  edgex_autoimpl *ai = (edgex_autoimpl *)p;
+  edgex_device *dev = ae_acquire (ai);
+  if (dev)
+  {
+    if (ae_read (ai, dev))
     {
-      iot_schedule_remove (ai->svc->scheduler, ai->handle);
+      return NULL;
     }
+    edgex_device_release (ai->svc, dev);
   }
+  ae_finish (ai);
   return NULL;
 }
 
+/* Batched reads: autoevents which fall due in the same tick on devices reporting the same
+ * connection key are read with one call to the driver's batch handler, in one pool job per key.
+ * Those without a key are read individually.
+ */
+
+typedef struct ae_pending
+{
+  edgex_autoimpl *ai;
+  edgex_device *dev;
+  const char *key;
+} ae_pending;
+
+typedef struct edgex_aegroup
+{
+  unsigned n;
+  ae_pending pend[];
+} edgex_aegroup;
+
+static int ae_pending_cmp (const void *a, const void *b)
+{
+  return strcmp (((const ae_pending *)a)->key, ((const ae_pending *)b)->key);
+}
+
+static void ae_read_group (devsdk_service_t *svc, ae_pending *pend, unsigned n)
+{
+  devsdk_batch_request *reqs = calloc (n, sizeof (devsdk_batch_request));
+  for (unsigned i = 0; i < n; i++)
+  {
+    reqs[i].device = pend[i].dev->devimpl;
+    reqs[i].nreadings = pend[i].ai->resource->nreqs;
+    reqs[i].requests = pend[i].ai->resource->reqs;
+    reqs[i].readings = calloc (reqs[i].nreadings, sizeof (devsdk_commandresult));
+  }
+  iot_log_debug (svc->logger, "AutoEvent: batched read of %u devices via %s", n, pend[0].key);
+  uint64_t start = monotime ();
+  svc->userfns.get_batch (svc->userdata, pend[0].key, n, reqs);
+  uint64_t elapsed = monotime () - start;
+  for (unsigned i = 0; i < n; i++)
+  {
+    ae_account (pend[i].ai, reqs[i].success, elapsed);
+    edgex_device_alloc_crlid (NULL);
+    iot_log_info (svc->logger, "AutoEvent: %s/%s", pend[i].ai->device, pend[i].ai->resource->name);
+    ae_process (pend[i].ai, pend[i].dev, reqs[i].success, reqs[i].readings, reqs[i].exception);
+    edgex_device_free_crlid ();
+    edgex_device_release (svc, pend[i].dev);
+    ae_finish (pend[i].ai);
+  }
+  free (reqs);
+}
+
+/* Each autoevent in a group comes with a device reference, a reference on the autoevent and its in-flight state */
+
+static void *ae_group_runner (void *p)
+{
+  edgex_aegroup *group = (edgex_aegroup *)p;
+  ae_read_group (group->pend[0].ai->svc, group->pend, group->n);
+  free (group);
+  return NULL;
+}
+
+/* Each autoevent in a batch comes with a reference and its in-flight state, both released by ae_finish */
+
+static void *ae_batch_runner (void *p)
+{
+  edgex_aebatch *batch = (edgex_aebatch *)p;
+  for (unsigned i = 0; i < batch->n; i++)
+  {
+    ae_runner (batch->ais[i]);
+  }
+  free (batch);
+  return NULL;
+}
+
+/* Hand autoevents to be read individually to the thread pool, split into up to AE_BATCH_JOBS
+ * batches of at most AE_BATCH_MAX each.
+ */
+
+static void wheel_dispatch_batches (edgex_aewheel *w, edgex_autoimpl **due, unsigned ndue)
+{
+  unsigned per = (ndue + AE_BATCH_JOBS - 1) / AE_BATCH_JOBS;
+  if (per > AE_BATCH_MAX)
+  {
+    per = AE_BATCH_MAX;
+  }
+  for (unsigned i = 0; i < ndue; i += per)
+  {
+    unsigned n = (ndue - i < per) ? ndue - i : per;
+    edgex_aebatch *batch = malloc (sizeof (edgex_aebatch) + n * sizeof (edgex_autoimpl *));
+    batch->n = n;
+    memcpy (batch->ais, due + i, n * sizeof (edgex_autoimpl *));
+    iot_threadpool_add_work (w->svc->thpool, ae_batch_runner, batch, -1);
+  }
+}
+
+/* Hand the autoevents which fell due in a tick to the thread pool. With a batch reader, the whole
+ * tick is first grouped by connection key, each key becoming one job, so that a connection is
+ * never read from by more than one job at a time. The remainder are read individually.
+ */
+
+static void wheel_dispatch (edgex_aewheel *w, edgex_autoimpl **due, unsigned ndue)
+{
+  devsdk_service_t *svc = w->svc;
+  if (svc->userfns.get_batch == NULL || svc->userfns.conn_key == NULL)
+  {
+    wheel_dispatch_batches (w, due, ndue);
+    return;
+  }
+
+  unsigned n = 0;
+  unsigned nsingle = 0;
+  ae_pending *pend = malloc (ndue * sizeof (ae_pending));
+  edgex_autoimpl **single = malloc (ndue * sizeof (edgex_autoimpl *));
+  for (unsigned i = 0; i < ndue; i++)
+  {
+    edgex_device *dev = ae_acquire (due[i]);
+    if (dev == NULL)
+    {
+      ae_finish (due[i]);
+      continue;
+    }
+    const char *key = ae_address (due[i], dev) ? svc->userfns.conn_key (svc->userdata, dev->devimpl) : NULL;
+    if (key)
+    {
+      pend[n].ai = due[i];
+      pend[n].dev = dev;
+      pend[n].key = key;
+      n++;
+      continue;
+    }
+    if (dev->devimpl->address)
+    {
+      single[nsingle++] = due[i];
+    }
+    else
+    {
+      ae_account (due[i], false, 0);
+      ae_finish (due[i]);
+    }
+    edgex_device_release (svc, dev);
+  }
+
+  qsort (pend, n, sizeof (ae_pending), ae_pending_cmp);
+  for (unsigned i = 0, j; i < n; i = j)
+  {
+    for (j = i + 1; j < n && strcmp (pend[j].key, pend[i].key) == 0; j++);
+    edgex_aegroup *group = malloc (sizeof (edgex_aegroup) + (j - i) * sizeof (ae_pending));
+    group->n = j - i;
+    memcpy (group->pend, pend + i, (j - i) * sizeof (ae_pending));
+    iot_threadpool_add_work (svc->thpool, ae_group_runner, group, -1);
+  }
+  if (nsingle)
+  {
+    wheel_dispatch_batches (w, single, nsingle);
+  }
+  free (single);
+  free (pend);
+}
+
+static void *wheel_thread (void *p)
+{
+  edgex_aewheel *w = (edgex_aewheel *)p;
+  edgex_autoimpl **due = NULL;
+  unsigned size = 0;
+
+  pthread_mutex_lock (&w->mtx);
+  while (w->running)
+  {
+    uint64_t next = w->start + w->tick * AE_WHEEL_TICK;
+    if (monotime () < next)
+    {
+      struct timespec ts = { .tv_sec = next / IOT_SEC_TO_NS (1), .tv_nsec = next % IOT_SEC_TO_NS (1) };
+      pthread_cond_timedwait (&w->cond, &w->mtx, &ts);
+      continue;
+    }
+
+    /* Fired entries are moved to the slot for their next due tick as we go. If that is this
+     * slot again they are inserted at its head, behind the walk, so they are not revisited.
+     * Each gains a reference, held by its batch until it has run.
+     */
+    unsigned ndue = 0;
+    edgex_autoimpl *ai = w->slots[w->tick & (AE_WHEEL_SLOTS - 1)];
+    while (ai)
+    {
+      edgex_autoimpl *nextai = ai->wnext;
+      if (ai->due <= w->tick)
+      {
+        uint64_t step = ai->period * atomic_load (&ai->stretch);
+        wheel_unlink (ai);
+        ai->base += step;
+        if (ai->base <= w->tick)
+        {
+          ai->base = w->tick + step;
+        }
+        ai->due = ai->base + wheel_jitter (w, ai);
+        wheel_link (w, ai);
+        if (!wheel_claim (w, ai))
+        {
+          ai = nextai;
+          continue;
+        }
+        atomic_fetch_add (&ai->refs, 1);
+        if (ndue == size)
+        {
+          size = size ? size * 2 : 64;
+          due = realloc (due, size * sizeof (edgex_autoimpl *));
+        }
+        due[ndue++] = ai;
+      }
+      ai = nextai;
+    }
+    w->tick++;
+    w->load += (((uint64_t)ndue << 16) >> AE_LOAD_SHIFT) - (w->load >> AE_LOAD_SHIFT);
+    if (ndue > w->peak)
+    {
+      w->peak = ndue;
+    }
+    if (ndue)
+    {
+      pthread_mutex_unlock (&w->mtx);
+      wheel_dispatch (w, due, ndue);
+      pthread_mutex_lock (&w->mtx);
+    }
+  }
+  pthread_mutex_unlock (&w->mtx);
+  free (due);
+  return NULL;
+}
+
+edgex_aewheel *edgex_aewheel_alloc (devsdk_service_t *svc)
+{
+  pthread_condattr_t attr;
+  edgex_aewheel *w = calloc (1, sizeof (edgex_aewheel));
+  w->svc = svc;
+  w->seed = (unsigned)iot_time_nsecs ();
+  edgex_map_init (&w->stagger);
+  pthread_mutex_init (&w->mtx, NULL);
+  pthread_condattr_init (&attr);
+  pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+  pthread_cond_init (&w->cond, &attr);
+  pthread_condattr_destroy (&attr);
+  return w;
+}
+
+void edgex_aewheel_start (edgex_aewheel *w)
+{
+  pthread_mutex_lock (&w->mtx);
+  if (!w->running)
+  {
+    w->start = monotime () - w->tick * AE_WHEEL_TICK;
+    w->running = true;
+    iot_thread_create (&w->thread, wheel_thread, w, IOT_THREAD_NO_PRIORITY, IOT_THREAD_NO_AFFINITY, w->svc->logger);
+  }
+  pthread_mutex_unlock (&w->mtx);
+}
+
+void edgex_aewheel_stop (edgex_aewheel *w)
+{
+  bool running;
+  pthread_mutex_lock (&w->mtx);
+  running = w->running;
+  w->running = false;
+  pthread_cond_signal (&w->cond);
+  pthread_mutex_unlock (&w->mtx);
+  if (running)
+  {
+    pthread_join (w->thread, NULL);
+  }
+}
+
+void edgex_aewheel_load (edgex_aewheel *w, double *mean, unsigned *peak)
+{
+  pthread_mutex_lock (&w->mtx);
+  *mean = (double)w->load / 65536.0;
+  *peak = w->peak;
+  w->peak = 0;
+  pthread_mutex_unlock (&w->mtx);
+}
+
+void edgex_aewheel_free (edgex_aewheel *w)
+{
+  if (w)
+  {
+    edgex_aewheel_stop (w);
+    edgex_map_deinit (&w->stagger);
+    pthread_cond_destroy (&w->cond);
+    pthread_mutex_destroy (&w->mtx);
+    free (w);
+  }
+}
+
 static void *starter (void *p)
 {
   edgex_autoimpl *ai = (edgex_autoimpl *)p;
   ai->handle = ai->svc->userfns.ae_starter
   (
     ai->svc->userdata, ai->device, ai->protocols, ai->resource->name,
-    ai->resource->nreqs, ai->resource->reqs, ai->interval, ai->onChange
+    ai->resource->nreqs, ai->resource->reqs, ai->interval / 1000000, ai->onChange
   );
+  edgex_autoimpl_release (ai);
   return NULL;
 }
 
@@ -172,8 +1021,7 @@ void edgex_device_autoevent_start (devsdk_service_t *svc, edgex_device *dev)
         );
         continue;
       }
-      uint64_t interval = edgex_parsetime (ae->interval);
-      if (interval == 0)
+      if (ae->interval_ns == 0)
       {
         iot_log_error
         (
@@ -183,42 +1031,86 @@ void edgex_device_autoevent_start (devsdk_service_t *svc, edgex_device *dev)
         );
         continue;
       }
-      ae->impl = malloc (sizeof (edgex_autoimpl));
+      ae->impl = calloc (1, sizeof (edgex_autoimpl));
+      atomic_store (&ae->impl->refs, 1);
       ae->impl->svc = svc;
       ae->impl->last = NULL;
-      ae->impl->interval = interval;
+      ae->impl->primed = false;
+      ae->impl->threshold = ae->onChangeThreshold;
+      ae->impl->percent = ae->onChangePercent;
+      ae->impl->hysteresis = ae->onChangeHysteresis;
+      atomic_store (&ae->impl->stretch, 1);
+      ae->impl->interval = ae->interval_ns;
       ae->impl->resource = cmd;
-      ae->impl->device = strdup (dev->name);
-      ae->impl->protocols = devsdk_protocols_dup ((const devsdk_protocols *)dev->protocols);
+      ae->impl->nreqs = cmd->nreqs;
+      ae->impl->profile = cmd->profile;
+      edgex_deviceprofile_addref (cmd->profile);
+      ae->impl->device = edgex_intern_dup (dev->name);
+      ae->impl->protocols = svc->userfns.ae_starter ? devsdk_protocols_dup (dev->protocols) : NULL;
       ae->impl->handle = NULL;
       ae->impl->onChange = ae->onChange;
     }
     if (ae->impl->svc->userfns.ae_starter)
     {
+      atomic_fetch_add (&ae->impl->refs, 1);
       iot_threadpool_add_work (svc->thpool, starter, ae->impl, -1);
     }
     else
     {
-      ae->impl->handle = iot_schedule_create
-        (svc->scheduler, ae_runner, edgex_autoimpl_release, ae->impl, IOT_MS_TO_NS(ae->impl->interval), 0, 0, svc->thpool, -1);
-      iot_schedule_add (ae->impl->svc->scheduler, ae->impl->handle);
+      wheel_add (svc->aewheel, ae->impl);
     }
   }
 }
 
+bool edgex_device_autoevent_stats (const edgex_device_autoevents *ae, edgex_autoevent_stats *stats)
+{
+  const edgex_autoimpl *ai = ae->impl;
+  if (ai == NULL || ai->svc->userfns.ae_starter)
+  {
+    return false;
+  }
+  stats->overruns = atomic_load (&ai->overruns);
+  stats->skipped = atomic_load (&ai->skipped);
+  stats->maxruntime = atomic_load (&ai->maxruntime);
+  stats->stretch = atomic_load (&ai->stretch);
+  stats->inflight = atomic_load (&ai->inflight) != AE_IDLE;
+  return true;
+}
+
+size_t edgex_device_autoevent_memory (const edgex_device_autoevents *ae)
+{
+  size_t result = sizeof (edgex_device_autoevents);
+  if (ae->impl)
+  {
+    result += sizeof (edgex_autoimpl);
+    if (ae->impl->last)
+    {
+      result += 2 * ae->impl->nreqs * sizeof (edgex_aeslot);
+    }
+    for (const devsdk_protocols *p = ae->impl->protocols; p; p = p->next)
+    {
+      result += sizeof (devsdk_protocols);
+    }
+  }
+  return result;
+}
+
 static void stopper (edgex_autoimpl *ai)
 {
   void *handle = ai->handle;
   ai->handle = NULL;
-  if (ai->svc->userfns.ae_stopper)
+  if (ai->svc->userfns.ae_starter)
   {
-    ai->svc->userfns.ae_stopper (ai->svc->userdata, handle);
-    edgex_autoimpl_release (ai);
+    if (ai->svc->userfns.ae_stopper)
+    {
+      ai->svc->userfns.ae_stopper (ai->svc->userdata, handle);
+    }
   }
   else
   {
-    iot_schedule_delete (ai->svc->scheduler, handle);
+    wheel_remove (ai->svc->aewheel, ai);
   }
+  edgex_autoimpl_release (ai);
 }
 
 void edgex_device_autoevent_stop (edgex_device *dev)
@@ -11,8 +11,39 @@
 
 #include "service.h"
 
+/* Timer wheel which drives SDK-scheduled autoevents */
+
+edgex_aewheel *edgex_aewheel_alloc (devsdk_service_t *svc);
+
+void edgex_aewheel_start (edgex_aewheel *w);
+
+void edgex_aewheel_stop (edgex_aewheel *w);
+
+/* Smoothed number of autoevents dispatched per tick, and the most in any one tick since the last call */
+
+void edgex_aewheel_load (edgex_aewheel *w, double *mean, unsigned *peak);
+
+void edgex_aewheel_free (edgex_aewheel *w);
+
 void edgex_device_autoevent_start (devsdk_service_t *svc, edgex_device *dev);
 
 void edgex_device_autoevent_stop (edgex_device *dev);
 
+/* Runtime statistics of an SDK-scheduled autoevent. Returns false if the autoevent is not running or is driver-managed */
+
+typedef struct edgex_autoevent_stats
+{
+  uint64_t overruns;               // reads which took longer than the interval
+  uint64_t skipped;                // firings dropped because a read was already in flight
+  uint64_t maxruntime;             // longest read, nanoseconds
+  unsigned stretch;                // current backoff, as a multiple of the interval
+  bool inflight;
+} edgex_autoevent_stats;
+
+bool edgex_device_autoevent_stats (const edgex_device_autoevents *ae, edgex_autoevent_stats *stats);
+
+/* Approximate heap usage of an autoevent and its runtime state, excluding interned names */
+
+size_t edgex_device_autoevent_memory (const edgex_device_autoevents *ae);
+
 #endif
@@ -94,6 +94,13 @@ static void edgex_bus_endpoint_free (void *p)
 
 static char *edgex_data_to_b64 (const iot_data_t *src)
 {
+  if (iot_data_type (src) == IOT_DATA_BINARY)
+  {
+    size_t encsz = iot_b64_encodesize (iot_data_array_size (src));
+    char *result = malloc (encsz);
+    iot_b64_encode (iot_data_address (src), iot_data_array_size (src), result, encsz);
+    return result;
+  }
   char *json = iot_data_to_json (src);
   size_t sz = strlen (json); // ignore the last null character, which causes an unmarshal error in core-data
   size_t encsz = iot_b64_encodesize (sz);
@@ -112,7 +119,9 @@ void edgex_bus_post (edgex_bus_t *bus, const char *path, const iot_data_t *paylo
   }
   iot_data_string_map_add (envelope, "apiVersion", iot_data_alloc_string (EDGEX_API_VERSION, IOT_DATA_REF));
   iot_data_string_map_add (envelope, "errorCode", iot_data_alloc_ui32 (0));
-  iot_data_string_map_add (envelope, "contentType", iot_data_alloc_string ("application/json", IOT_DATA_REF));
+  /* A binary payload is an already-encoded CBOR event */
+  bool cbor = (iot_data_type (payload) == IOT_DATA_BINARY);
+  iot_data_string_map_add (envelope, "contentType", iot_data_alloc_string (cbor ? "application/cbor" : "application/json", IOT_DATA_REF));
   if (bus->msgb64payload)
   {
     iot_data_string_map_add (envelope, "payload", iot_data_alloc_string (edgex_data_to_b64 (payload), IOT_DATA_TAKE));
@@ -11,6 +11,17 @@
 
 #include "edgex/edgex.h"
 #include "devsdk/devsdk.h"
+#include "map.h"
+
+/* The cmdinfo for all of a profile's commands are held in a single
+ * cache-line aligned allocation, headed by the first edgex_cmdinfo. The
+ * per-request fields are stored as parallel arrays which are shared across
+ * the profile, each cmdinfo addressing its own slice of them. Property
+ * values are copied in; the strings they reference remain owned by the
+ * profile's device resources.
+ */
+
+#define EDGEX_CMDINFO_ALIGN 64
 
 typedef struct edgex_cmdinfo
 {
@@ -19,10 +30,28 @@ typedef struct edgex_cmdinfo
   bool isget;
   unsigned nreqs;
   devsdk_commandrequest *reqs;
-  edgex_propertyvalue **pvals;
+  edgex_propertyvalue *pvals;
   iot_data_t **maps;
   char **dfls;
   struct edgex_cmdinfo *next;
 } edgex_cmdinfo;
 
+typedef edgex_map(edgex_cmdinfo *) edgex_map_cmdinfo;
+typedef edgex_map(edgex_deviceresource *) edgex_map_deviceresource;
+
+/* Hashed lookup tables for a profile's commands and resources. These are
+ * built when the profile is added to the devmap and are not modified
+ * afterwards, so may be read without locking.
+ */
+
+typedef struct edgex_cmdindex
+{
+  edgex_map_cmdinfo getcmds;
+  edgex_map_cmdinfo setcmds;
+  edgex_map_deviceresource resources;
+  size_t infosize;
+} edgex_cmdindex;
+
+extern void edgex_cmdindex_free (edgex_cmdindex *idx);
+
 #endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include "compress.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <zlib.h>
+
+/* One stream per coding per thread. The window size selects the framing: 15 gives the zlib
+   wrapper which HTTP calls deflate, and adding 16 gives gzip */
+
+typedef struct edgex_zctx
+{
+  z_stream strm[2];
+  int level[2];
+  bool init[2];
+} edgex_zctx;
+
+static pthread_key_t zctx_key;
+static pthread_once_t zctx_once = PTHREAD_ONCE_INIT;
+
+static void zctx_free (void *p)
+{
+  edgex_zctx *z = (edgex_zctx *)p;
+  for (int i = 0; i < 2; i++)
+  {
+    if (z->init[i])
+    {
+      deflateEnd (&z->strm[i]);
+    }
+  }
+  free (z);
+}
+
+static void zctx_key_create (void)
+{
+  pthread_key_create (&zctx_key, zctx_free);
+}
+
+static z_stream *zctx_get (edgex_coding coding, int level)
+{
+  pthread_once (&zctx_once, zctx_key_create);
+  edgex_zctx *z = pthread_getspecific (zctx_key);
+  if (z == NULL)
+  {
+    z = calloc (1, sizeof (edgex_zctx));
+    pthread_setspecific (zctx_key, z);
+  }
+  int i = (coding == EDGEX_CODING_GZIP) ? 0 : 1;
+  if (z->init[i] && z->level[i] != level)
+  {
+    deflateEnd (&z->strm[i]);
+    z->init[i] = false;
+  }
+  if (z->init[i])
+  {
+    deflateReset (&z->strm[i]);
+  }
+  else
+  {
+    memset (&z->strm[i], 0, sizeof (z_stream));
+    if (deflateInit2 (&z->strm[i], level, Z_DEFLATED, (coding == EDGEX_CODING_GZIP) ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      return NULL;
+    }
+    z->init[i] = true;
+    z->level[i] = level;
+  }
+  return &z->strm[i];
+}
+
+edgex_coding edgex_compress_negotiate (const char *accept)
+{
+  bool gzip = false;
+  bool deflate = false;
+  if (accept)
+  {
+    char *list = strdup (accept);
+    char *sptr = NULL;
+    for (char *elem = strtok_r (list, ",", &sptr); elem; elem = strtok_r (NULL, ",", &sptr))
+    {
+      while (*elem == ' ' || *elem == '\t') elem++;
+      size_t len = strcspn (elem, " \t;");
+      const char *q = strstr (elem + len, "q=");
+      bool ok = (q == NULL) || (strtod (q + 2, NULL) > 0.0);
+      if (len == 4 && strncasecmp (elem, "gzip", 4) == 0)
+      {
+        gzip = ok;
+      }
+      else if (len == 7 && strncasecmp (elem, "deflate", 7) == 0)
+      {
+        deflate = ok;
+      }
+    }
+    free (list);
+  }
+  return gzip ? EDGEX_CODING_GZIP : deflate ? EDGEX_CODING_DEFLATE : EDGEX_CODING_NONE;
+}
+
+const char *edgex_compress_name (edgex_coding coding)
+{
+  switch (coding)
+  {
+    case EDGEX_CODING_GZIP: return "gzip";
+    case EDGEX_CODING_DEFLATE: return "deflate";
+    default: return "identity";
+  }
+}
+
+void *edgex_compress (edgex_coding coding, int level, const void *data, size_t size, size_t *outsize)
+{
+  z_stream *strm = (coding == EDGEX_CODING_NONE) ? NULL : zctx_get (coding, level);
+  if (strm == NULL)
+  {
+    return NULL;
+  }
+  size_t bound = deflateBound (strm, size);
+  unsigned char *out = malloc (bound);
+  strm->next_in = (Bytef *)data;
+  strm->avail_in = size;
+  strm->next_out = out;
+  strm->avail_out = bound;
+  if (deflate (strm, Z_FINISH) != Z_STREAM_END || strm->total_out >= size)
+  {
+    free (out);
+    return NULL;
+  }
+  *outsize = strm->total_out;
+  return out;
+}
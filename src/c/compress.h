@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef _EDGEX_DEVICE_COMPRESS_H_
+#define _EDGEX_DEVICE_COMPRESS_H_ 1
+
+#include <stddef.h>
+
+/* Content codings which the REST server can apply to its responses */
+
+typedef enum
+{
+  EDGEX_CODING_NONE,
+  EDGEX_CODING_GZIP,
+  EDGEX_CODING_DEFLATE
+} edgex_coding;
+
+/* Choose a coding from an Accept-Encoding header, preferring gzip. NULL selects none. */
+
+extern edgex_coding edgex_compress_negotiate (const char *accept);
+
+/* The Content-Encoding token for a coding */
+
+extern const char *edgex_compress_name (edgex_coding coding);
+
+/* Compress size bytes of data at the given zlib level. Returns a malloc'd buffer and sets
+ * *outsize, or returns NULL if compression failed or would not make the data smaller.
+ * The zlib streams are kept per thread and reset between calls.
+ */
+
+extern void *edgex_compress (edgex_coding coding, int level, const void *data, size_t size, size_t *outsize);
+
+#endif
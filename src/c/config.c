@@ -75,6 +75,13 @@ iot_data_t *edgex_common_config_defaults (const char *svcname)
   iot_data_string_map_add (result, "Service/HealthCheckInterval", iot_data_alloc_string ("", IOT_DATA_REF));
   iot_data_string_map_add (result, "Service/ServerBindAddr", iot_data_alloc_string ("", IOT_DATA_REF));
   iot_data_string_map_add (result, "Service/MaxRequestSize", iot_data_alloc_ui64 (0));
+  iot_data_string_map_add (result, "Service/ServerMode", iot_data_alloc_string ("ThreadPerConnection", IOT_DATA_REF));
+  iot_data_string_map_add (result, "Service/ServerThreads", iot_data_alloc_ui32 (4));
+  iot_data_string_map_add (result, "Service/MaxConnections", iot_data_alloc_ui32 (0));
+  iot_data_string_map_add (result, "Service/MaxConnectionsPerIP", iot_data_alloc_ui32 (0));
+  iot_data_string_map_add (result, "Service/StreamThreshold", iot_data_alloc_ui64 (1048576));
+  iot_data_string_map_add (result, "Service/CompressionMinSize", iot_data_alloc_ui32 (0));
+  iot_data_string_map_add (result, "Service/CompressionLevel", iot_data_alloc_ui32 (6));
   iot_data_string_map_add (result, "Service/CORSConfiguration/EnableCORS", iot_data_alloc_bool (false));
   iot_data_string_map_add (result, "Service/CORSConfiguration/CORSAllowCredentials", iot_data_alloc_bool (false));
   iot_data_string_map_add (result, "Service/CORSConfiguration/CORSAllowedOrigin", iot_data_alloc_string ("https://localhost", IOT_DATA_REF));
@@ -89,6 +96,7 @@ iot_data_t *edgex_common_config_defaults (const char *svcname)
   iot_data_string_map_add (result, "Device/EventQLength", iot_data_alloc_ui32 (0));
   iot_data_string_map_add (result, "Device/AllowedFails", iot_data_alloc_i32 (0));
   iot_data_string_map_add (result, "Device/DeviceDownTimeout", iot_data_alloc_ui64 (0));
+  iot_data_string_map_add (result, "Device/LastConnectedInterval", iot_data_alloc_ui32 (1000));
 
   iot_data_string_map_add (result, EX_BUS_TYPE, iot_data_alloc_string ("mqtt", IOT_DATA_REF));
   edgex_bus_config_defaults (result, svcname);
@@ -104,6 +112,8 @@ iot_data_t *edgex_common_config_defaults (const char *svcname)
   iot_data_string_map_add (result, "SecretStore/Authentication/AuthType", iot_data_alloc_string ("X-Vault-Token", IOT_DATA_REF));
   iot_data_string_map_add (result, "SecretStore/SecretsFile", iot_data_alloc_string ("", IOT_DATA_REF));
   iot_data_string_map_add (result, "SecretStore/DisableScrubSecretsFile", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, "SecretStore/TokenCacheSize", iot_data_alloc_ui32 (256));
+  iot_data_string_map_add (result, "SecretStore/TokenRecheckInterval", iot_data_alloc_ui32 (30));
 
   return result;
 }
@@ -117,10 +127,19 @@ iot_data_t *edgex_private_config_defaults (const iot_data_t *driverconf)
   iot_data_string_map_add (result, DYN_PREFIX "LogLevel", iot_data_alloc_string ("WARNING", IOT_DATA_REF));
 
   iot_data_string_map_add (result, "Device/UpdateLastConnected", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, "Device/ParallelAttributeParsing", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, "Device/AutoEvents/Phase", iot_data_alloc_string ("None", IOT_DATA_REF));
+  iot_data_string_map_add (result, "Device/AutoEvents/Jitter", iot_data_alloc_ui32 (0));
+  iot_data_string_map_add (result, "Device/AutoEvents/MaxBackoff", iot_data_alloc_ui32 (16));
+  iot_data_string_map_add (result, "Device/AutoEvents/Overrun", iot_data_alloc_string ("Skip", IOT_DATA_REF));
   iot_data_string_map_add (result, "MaxEventSize", iot_data_alloc_ui32 (0));
 
   iot_data_string_map_add (result, DYN_PREFIX "Telemetry/PublishTopicPrefix", iot_data_alloc_string (DEFAULTMETRICSTOPIC, IOT_DATA_REF));
   iot_data_string_map_add (result, DYN_PREFIX "Telemetry/Metrics/ReadCommandsExecuted", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, DYN_PREFIX "Telemetry/Metrics/AutoEventTickLoad", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, DYN_PREFIX "Telemetry/Metrics/SecurityTokenCache", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, DYN_PREFIX "Telemetry/Metrics/HttpClientPool", iot_data_alloc_bool (false));
+  iot_data_string_map_add (result, DYN_PREFIX "Telemetry/Metrics/LastConnectedUpdates", iot_data_alloc_bool (false));
 
   iot_data_string_map_add (result, "Service/Host", iot_data_alloc_string (utsbuffer.nodename, IOT_DATA_COPY));
   iot_data_string_map_add (result, "Service/Port", iot_data_alloc_ui16 (59999));
@@ -476,6 +495,18 @@ static void edgex_device_populateCommonConfigFromMap (edgex_device_config *confi
   config->service.checkinterval = iot_data_string_map_get_string (map, "Service/HealthCheckInterval");
   config->service.bindaddr = iot_data_string_map_get_string (map, "Service/ServerBindAddr");
   config->service.maxreqsz = iot_data_ui64 (iot_data_string_map_get (map, "Service/MaxRequestSize"));
+  const char *mode = iot_data_string_map_get_string (map, "Service/ServerMode");
+  config->service.serverpool = mode && strcasecmp (mode, "Pool") == 0;
+  config->service.serverthreads = iot_data_ui32 (iot_data_string_map_get (map, "Service/ServerThreads"));
+  config->service.maxconns = iot_data_ui32 (iot_data_string_map_get (map, "Service/MaxConnections"));
+  config->service.maxconnsperip = iot_data_ui32 (iot_data_string_map_get (map, "Service/MaxConnectionsPerIP"));
+  config->service.streamsize = iot_data_ui64 (iot_data_string_map_get (map, "Service/StreamThreshold"));
+  config->service.compressmin = iot_data_ui32 (iot_data_string_map_get (map, "Service/CompressionMinSize"));
+  config->service.compresslevel = iot_data_ui32 (iot_data_string_map_get (map, "Service/CompressionLevel"));
+  if (config->service.compresslevel > 9)
+  {
+    config->service.compresslevel = 9;
+  }
 
   if (config->service.labels)
   {
@@ -512,6 +543,7 @@ static void edgex_device_populateCommonConfigFromMap (edgex_device_config *confi
   config->device.devicesdir = iot_data_string_map_get_string (map, "Device/DevicesDir");
   config->device.allowed_fails = iot_data_ui32 (iot_data_string_map_get (map, "Device/AllowedFails"));
   config->device.dev_downtime = iot_data_ui64 (iot_data_string_map_get (map, "Device/DeviceDownTimeout"));
+  config->device.lcinterval = iot_data_ui32 (iot_data_string_map_get (map, "Device/LastConnectedInterval"));
 
   config->metrics.interval = iot_data_string_map_get_string (map, DYN_PREFIX "Telemetry/Interval");
   config->metrics.flags = iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/EventsSent")) ? EX_METRIC_EVSENT : 0;
@@ -528,9 +560,35 @@ static void edgex_device_populateConfigFromMap (edgex_device_config *config, con
 
   config->device.updatelastconnected = iot_data_bool (iot_data_string_map_get (map, "Device/UpdateLastConnected"));
   config->device.eventqlen = iot_data_ui32 (iot_data_string_map_get (map, "Device/EventQLength"));
+  config->device.parallelattrs = iot_data_bool (iot_data_string_map_get (map, "Device/ParallelAttributeParsing"));
+  const char *phase = iot_data_string_map_get_string (map, "Device/AutoEvents/Phase");
+  if (phase && strcasecmp (phase, "Hash") == 0)
+  {
+    config->device.aephase = EDGEX_AE_PHASE_HASH;
+  }
+  else if (phase && strcasecmp (phase, "Stagger") == 0)
+  {
+    config->device.aephase = EDGEX_AE_PHASE_STAGGER;
+  }
+  else
+  {
+    config->device.aephase = EDGEX_AE_PHASE_NONE;
+  }
+  config->device.aejitter = iot_data_ui32 (iot_data_string_map_get (map, "Device/AutoEvents/Jitter"));
+  config->device.aebackoff = iot_data_ui32 (iot_data_string_map_get (map, "Device/AutoEvents/MaxBackoff"));
+  if (config->device.aebackoff == 0)
+  {
+    config->device.aebackoff = 1;
+  }
+  const char *overrun = iot_data_string_map_get_string (map, "Device/AutoEvents/Overrun");
+  config->device.aequeue = overrun && strcasecmp (overrun, "Queue") == 0;
 
   config->metrics.topic = iot_data_string_map_get_string (map, DYN_PREFIX "Telemetry/PublishTopicPrefix");
   if (iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/ReadCommandsExecuted"))) config->metrics.flags |= EX_METRIC_RDCMDS;
+  if (iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/AutoEventTickLoad"))) config->metrics.flags |= EX_METRIC_AELOAD;
+  if (iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/SecurityTokenCache"))) config->metrics.flags |= EX_METRIC_JWTCACHE;
+  if (iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/HttpClientPool"))) config->metrics.flags |= EX_METRIC_HTTPPOOL;
+  if (iot_data_bool (iot_data_string_map_get (map, DYN_PREFIX "Telemetry/Metrics/LastConnectedUpdates"))) config->metrics.flags |= EX_METRIC_LCUPDATE;
 }
 
 void edgex_device_populateConfig (devsdk_service_t *svc, iot_data_t *config)
@@ -739,8 +797,19 @@ static JSON_Value *edgex_device_config_toJson (devsdk_service_t *svc)
   json_object_set_boolean
     (dobj, "UpdateLastConnected", svc->config.device.updatelastconnected);
   json_object_set_uint (dobj, "EventQLength", svc->config.device.eventqlen);
+  json_object_set_boolean (dobj, "ParallelAttributeParsing", svc->config.device.parallelattrs);
+
+  JSON_Value *aeval = json_value_init_object ();
+  JSON_Object *aeobj = json_value_get_object (aeval);
+  static const char *phases[] = { "None", "Hash", "Stagger" };
+  json_object_set_string (aeobj, "Phase", phases[svc->config.device.aephase]);
+  json_object_set_uint (aeobj, "Jitter", svc->config.device.aejitter);
+  json_object_set_uint (aeobj, "MaxBackoff", svc->config.device.aebackoff);
+  json_object_set_string (aeobj, "Overrun", svc->config.device.aequeue ? "Queue" : "Skip");
+  json_object_set_value (dobj, "AutoEvents", aeval);
   json_object_set_uint (dobj, "AllowedFails", svc->config.device.allowed_fails);
   json_object_set_uint (dobj, "DeviceDownTimeout", svc->config.device.dev_downtime);
+  json_object_set_uint (dobj, "LastConnectedInterval", svc->config.device.lcinterval);
 
   JSON_Value *lval = json_value_init_array ();
   JSON_Array *larr = json_value_get_array (lval);
@@ -778,6 +847,10 @@ static JSON_Value *edgex_device_config_toJson (devsdk_service_t *svc)
   json_object_set_boolean (mobj, "ReadCommandsExecuted", svc->config.metrics.flags & EX_METRIC_RDCMDS);
   json_object_set_boolean (mobj, "SecuritySecretsRequested", svc->config.metrics.flags & EX_METRIC_SECREQ);
   json_object_set_boolean (mobj, "SecuritySecretsStored", svc->config.metrics.flags & EX_METRIC_SECSTO);
+  json_object_set_boolean (mobj, "AutoEventTickLoad", svc->config.metrics.flags & EX_METRIC_AELOAD);
+  json_object_set_boolean (mobj, "SecurityTokenCache", svc->config.metrics.flags & EX_METRIC_JWTCACHE);
+  json_object_set_boolean (mobj, "HttpClientPool", svc->config.metrics.flags & EX_METRIC_HTTPPOOL);
+  json_object_set_boolean (mobj, "LastConnectedUpdates", svc->config.metrics.flags & EX_METRIC_LCUPDATE);
   json_object_set_value (obj, "Telemetry", mval);
 
   JSON_Value *sval = json_value_init_object ();
@@ -791,6 +864,13 @@ static JSON_Value *edgex_device_config_toJson (devsdk_service_t *svc)
     (sobj, "HealthCheckInterval", svc->config.service.checkinterval);
   json_object_set_string (sobj, "ServerBindAddr", svc->config.service.bindaddr);
   json_object_set_uint (sobj, "MaxRequestSize", svc->config.service.maxreqsz);
+  json_object_set_string (sobj, "ServerMode", svc->config.service.serverpool ? "Pool" : "ThreadPerConnection");
+  json_object_set_uint (sobj, "ServerThreads", svc->config.service.serverthreads);
+  json_object_set_uint (sobj, "MaxConnections", svc->config.service.maxconns);
+  json_object_set_uint (sobj, "MaxConnectionsPerIP", svc->config.service.maxconnsperip);
+  json_object_set_uint (sobj, "StreamThreshold", svc->config.service.streamsize);
+  json_object_set_uint (sobj, "CompressionMinSize", svc->config.service.compressmin);
+  json_object_set_uint (sobj, "CompressionLevel", svc->config.service.compresslevel);
 
   JSON_Value *scval = json_value_init_object ();
   JSON_Object *scobj = json_value_get_object (scval);
@@ -19,6 +19,10 @@
 #define EX_METRIC_RDCMDS 0x4
 #define EX_METRIC_SECREQ 0x8
 #define EX_METRIC_SECSTO 0x10
+#define EX_METRIC_AELOAD 0x20
+#define EX_METRIC_JWTCACHE 0x40
+#define EX_METRIC_HTTPPOOL 0x80
+#define EX_METRIC_LCUPDATE 0x100
 
 typedef struct edgex_device_serviceinfo
 {
@@ -30,6 +34,13 @@ typedef struct edgex_device_serviceinfo
   const char *checkinterval;
   const char *bindaddr;
   uint64_t maxreqsz;
+  bool serverpool;
+  uint32_t serverthreads;
+  uint32_t maxconns;
+  uint32_t maxconnsperip;
+  uint64_t streamsize;
+  uint32_t compressmin;
+  uint32_t compresslevel;
 } edgex_device_serviceinfo;
 
 typedef struct edgex_device_service_endpoint
@@ -50,6 +61,13 @@ typedef struct edgex_device_metricinfo
   const char *topic;
 } edgex_device_metricinfo;
 
+typedef enum
+{
+  EDGEX_AE_PHASE_NONE,     // autoevents first fire one interval after they are started
+  EDGEX_AE_PHASE_HASH,     // offset within the interval by a hash of the device and resource names
+  EDGEX_AE_PHASE_STAGGER   // offsets spread evenly across autoevents sharing an interval
+} edgex_ae_phase;
+
 typedef struct edgex_device_deviceinfo
 {
   atomic_bool datatransform;
@@ -60,9 +78,15 @@ typedef struct edgex_device_deviceinfo
   const char *profilesdir;
   const char *devicesdir;
   atomic_bool updatelastconnected;
+  bool parallelattrs;
+  edgex_ae_phase aephase;
+  uint32_t aejitter;
+  uint32_t aebackoff;
+  bool aequeue;
   uint32_t eventqlen;
   uint32_t allowed_fails;
   uint64_t dev_downtime;
+  uint32_t lcinterval;
 } edgex_device_deviceinfo;
 
 typedef struct edgex_device_watcherinfo
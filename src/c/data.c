@@ -45,6 +45,319 @@ static char *edgex_value_tostring (const iot_data_t *value)
   return res;
 }
 
+/* CBOR encoding of events. Numeric arrays are written as RFC 8746 typed arrays straight from the
+   reading's buffer; other values are encoded as their natural CBOR counterparts. Large strings and
+   arrays are not copied into the encoding but referenced from the event, so the encoded stream is
+   the owned bytes with each reference spliced in at its offset */
+
+#define EDGEX_CBOR_REFMIN 1024
+
+typedef struct edgex_cbor_ref
+{
+  size_t at;
+  const uint8_t *ptr;
+  size_t len;
+} edgex_cbor_ref;
+
+typedef struct edgex_cbor_buf
+{
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+  edgex_cbor_ref *refs;
+  unsigned nrefs;
+  size_t total;
+} edgex_cbor_buf;
+
+typedef struct edgex_cbor_stream
+{
+  edgex_cbor_buf *enc;
+  iot_data_t *value;             // keeps the referenced readings alive
+} edgex_cbor_stream;
+
+static void edgex_cbor_put (edgex_cbor_buf *b, const void *p, size_t n)
+{
+  if (b->len + n > b->cap)
+  {
+    while (b->len + n > b->cap)
+    {
+      b->cap = b->cap ? b->cap * 2 : 256;
+    }
+    b->data = realloc (b->data, b->cap);
+  }
+  memcpy (b->data + b->len, p, n);
+  b->len += n;
+  b->total += n;
+}
+
+static void edgex_cbor_put_ref (edgex_cbor_buf *b, const void *p, size_t n)
+{
+  if (n < EDGEX_CBOR_REFMIN)
+  {
+    edgex_cbor_put (b, p, n);
+  }
+  else
+  {
+    b->refs = realloc (b->refs, (b->nrefs + 1) * sizeof (edgex_cbor_ref));
+    b->refs[b->nrefs++] = (edgex_cbor_ref){ .at = b->len, .ptr = p, .len = n };
+    b->total += n;
+  }
+}
+
+/* Copy the part of a piece of the stream, starting at *off and n bytes long, that overlaps the request */
+
+static size_t edgex_cbor_span (const uint8_t *src, size_t n, uint64_t *off, uint64_t want, uint8_t *out, size_t room)
+{
+  size_t copied = 0;
+  if (want >= *off && want < *off + n)
+  {
+    size_t skip = want - *off;
+    copied = (n - skip < room) ? n - skip : room;
+    memcpy (out, src + skip, copied);
+  }
+  *off += n;
+  return copied;
+}
+
+static size_t edgex_cbor_read (const edgex_cbor_buf *b, uint64_t pos, void *buf, size_t max)
+{
+  uint8_t *out = buf;
+  size_t done = 0;
+  size_t dpos = 0;
+  uint64_t off = 0;
+  for (unsigned i = 0; i <= b->nrefs && done < max; i++)
+  {
+    size_t end = (i < b->nrefs) ? b->refs[i].at : b->len;
+    done += edgex_cbor_span (b->data + dpos, end - dpos, &off, pos + done, out + done, max - done);
+    dpos = end;
+    if (i < b->nrefs && done < max)
+    {
+      done += edgex_cbor_span (b->refs[i].ptr, b->refs[i].len, &off, pos + done, out + done, max - done);
+    }
+  }
+  return done;
+}
+
+static void edgex_cbor_free (edgex_cbor_buf *b)
+{
+  if (b)
+  {
+    free (b->data);
+    free (b->refs);
+    free (b);
+  }
+}
+
+static void edgex_cbor_head (edgex_cbor_buf *b, uint8_t major, uint64_t val)
+{
+  uint8_t head[9];
+  size_t n;
+  major <<= 5;
+  if (val < 24)
+  {
+    head[0] = major | val;
+    n = 1;
+  }
+  else
+  {
+    n = (val <= UINT8_MAX) ? 2 : (val <= UINT16_MAX) ? 3 : (val <= UINT32_MAX) ? 5 : 9;
+    head[0] = major | ((n == 2) ? 24 : (n == 3) ? 25 : (n == 5) ? 26 : 27);
+    for (size_t i = n - 1; i > 0; i--)
+    {
+      head[i] = val & 0xff;
+      val >>= 8;
+    }
+  }
+  edgex_cbor_put (b, head, n);
+}
+
+static void edgex_cbor_int (edgex_cbor_buf *b, int64_t val)
+{
+  if (val < 0)
+  {
+    edgex_cbor_head (b, 1, -1 - val);
+  }
+  else
+  {
+    edgex_cbor_head (b, 0, val);
+  }
+}
+
+/* A float of sz bytes, whose bit pattern is given by bits, written big-endian as CBOR requires */
+
+static void edgex_cbor_float (edgex_cbor_buf *b, uint64_t bits, size_t sz)
+{
+  uint8_t out[9];
+  out[0] = (sz == 4) ? 0xfa : 0xfb;
+  for (size_t i = sz; i > 0; i--)
+  {
+    out[i] = bits & 0xff;
+    bits >>= 8;
+  }
+  edgex_cbor_put (b, out, sz + 1);
+}
+
+/* RFC 8746 tag for a typed array of the given element type, or 0 if there is none */
+
+static uint64_t edgex_cbor_array_tag (iot_data_type_t t)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  const uint64_t le = 4;
+#else
+  const uint64_t le = 0;
+#endif
+  switch (t)
+  {
+    case IOT_DATA_UINT8: return 64;
+    case IOT_DATA_INT8: return 72;
+    case IOT_DATA_UINT16: return 65 + le;
+    case IOT_DATA_UINT32: return 66 + le;
+    case IOT_DATA_UINT64: return 67 + le;
+    case IOT_DATA_INT16: return 73 + le;
+    case IOT_DATA_INT32: return 74 + le;
+    case IOT_DATA_INT64: return 75 + le;
+    case IOT_DATA_FLOAT32: return 81 + le;
+    case IOT_DATA_FLOAT64: return 82 + le;
+    default: return 0;
+  }
+}
+
+static void edgex_cbor_encode (edgex_cbor_buf *b, const iot_data_t *value)
+{
+  static const uint8_t cfalse = 0xf4;
+  static const uint8_t ctrue = 0xf5;
+  static const uint8_t cnull = 0xf6;
+
+  switch (value ? iot_data_type (value) : IOT_DATA_NULL)
+  {
+    case IOT_DATA_INT8: edgex_cbor_int (b, iot_data_i8 (value)); break;
+    case IOT_DATA_UINT8: edgex_cbor_head (b, 0, iot_data_ui8 (value)); break;
+    case IOT_DATA_INT16: edgex_cbor_int (b, iot_data_i16 (value)); break;
+    case IOT_DATA_UINT16: edgex_cbor_head (b, 0, iot_data_ui16 (value)); break;
+    case IOT_DATA_INT32: edgex_cbor_int (b, iot_data_i32 (value)); break;
+    case IOT_DATA_UINT32: edgex_cbor_head (b, 0, iot_data_ui32 (value)); break;
+    case IOT_DATA_INT64: edgex_cbor_int (b, iot_data_i64 (value)); break;
+    case IOT_DATA_UINT64: edgex_cbor_head (b, 0, iot_data_ui64 (value)); break;
+    case IOT_DATA_FLOAT32:
+    {
+      float f = iot_data_f32 (value);
+      uint32_t bits;
+      memcpy (&bits, &f, sizeof (bits));
+      edgex_cbor_float (b, bits, sizeof (bits));
+      break;
+    }
+    case IOT_DATA_FLOAT64:
+    {
+      double d = iot_data_f64 (value);
+      uint64_t bits;
+      memcpy (&bits, &d, sizeof (bits));
+      edgex_cbor_float (b, bits, sizeof (bits));
+      break;
+    }
+    case IOT_DATA_BOOL: edgex_cbor_put (b, iot_data_bool (value) ? &ctrue : &cfalse, 1); break;
+    case IOT_DATA_STRING:
+    {
+      const char *str = iot_data_string (value);
+      edgex_cbor_head (b, 3, strlen (str));
+      edgex_cbor_put_ref (b, str, strlen (str));
+      break;
+    }
+    case IOT_DATA_BINARY:
+      edgex_cbor_head (b, 2, iot_data_array_size (value));
+      edgex_cbor_put_ref (b, iot_data_address (value), iot_data_array_size (value));
+      break;
+    case IOT_DATA_ARRAY:
+    {
+      uint64_t tag = edgex_cbor_array_tag (iot_data_array_type (value));
+      if (tag)
+      {
+        edgex_cbor_head (b, 6, tag);
+        edgex_cbor_head (b, 2, iot_data_array_size (value));
+        edgex_cbor_put_ref (b, iot_data_address (value), iot_data_array_size (value));
+      }
+      else
+      {
+        const bool *elems = iot_data_address (value);
+        edgex_cbor_head (b, 4, iot_data_array_length (value));
+        for (uint32_t i = 0; i < iot_data_array_length (value); i++)
+        {
+          edgex_cbor_put (b, elems[i] ? &ctrue : &cfalse, 1);
+        }
+      }
+      break;
+    }
+    case IOT_DATA_VECTOR:
+    {
+      iot_data_vector_iter_t iter;
+      edgex_cbor_head (b, 4, iot_data_vector_size (value));
+      iot_data_vector_iter (value, &iter);
+      while (iot_data_vector_iter_next (&iter))
+      {
+        edgex_cbor_encode (b, iot_data_vector_iter_value (&iter));
+      }
+      break;
+    }
+    case IOT_DATA_LIST:
+    {
+      iot_data_list_iter_t iter;
+      edgex_cbor_head (b, 4, iot_data_list_length (value));
+      iot_data_list_iter (value, &iter);
+      while (iot_data_list_iter_next (&iter))
+      {
+        edgex_cbor_encode (b, iot_data_list_iter_value (&iter));
+      }
+      break;
+    }
+    case IOT_DATA_MAP:
+    {
+      iot_data_map_iter_t iter;
+      edgex_cbor_head (b, 5, iot_data_map_size (value));
+      iot_data_map_iter (value, &iter);
+      while (iot_data_map_iter_next (&iter))
+      {
+        edgex_cbor_encode (b, iot_data_map_iter_key (&iter));
+        edgex_cbor_encode (b, iot_data_map_iter_value (&iter));
+      }
+      break;
+    }
+    default:
+      edgex_cbor_put (b, &cnull, 1);
+  }
+}
+
+/* The encoding is built on first use and kept, so that the size check, the publish and any reply share it */
+
+static edgex_cbor_buf *edgex_event_cooked_cbor (edgex_event_cooked *e)
+{
+  if (e->cbor == NULL)
+  {
+    e->cbor = calloc (1, sizeof (edgex_cbor_buf));
+    edgex_cbor_encode (e->cbor, e->value);
+  }
+  return e->cbor;
+}
+
+static iot_data_t *edgex_event_cooked_cbor_flat (edgex_event_cooked *e)
+{
+  edgex_cbor_buf *b = edgex_event_cooked_cbor (e);
+  uint8_t *bytes = malloc (b->total);
+  edgex_cbor_read (b, 0, bytes, b->total);
+  return iot_data_alloc_binary (bytes, b->total, IOT_DATA_TAKE);
+}
+
+static ssize_t edgex_cbor_stream_read (void *ctx, uint64_t pos, char *buf, size_t max)
+{
+  return edgex_cbor_read (((edgex_cbor_stream *)ctx)->enc, pos, buf, max);
+}
+
+static void edgex_cbor_stream_free (void *ctx)
+{
+  edgex_cbor_stream *st = (edgex_cbor_stream *)ctx;
+  edgex_cbor_free (st->enc);
+  iot_data_free (st->value);
+  free (st);
+}
+
 /* Event data structure:
 
 Reading:
@@ -92,15 +405,15 @@ edgex_event_cooked *edgex_data_process_event
 
   for (uint32_t i = 0; i < commandinfo->nreqs; i++)
   {
-    if (commandinfo->pvals[i]->type.type == IOT_DATA_BINARY)
+    if (commandinfo->pvals[i].type.type == IOT_DATA_BINARY)
     {
       useCBOR = true;
     }
     if (doTransforms)
     {
-      edgex_transform_outgoing (&values[i], commandinfo->pvals[i], commandinfo->maps[i]);
+      edgex_transform_outgoing (&values[i], &commandinfo->pvals[i], commandinfo->maps[i]);
     }
-    const char *assertion = commandinfo->pvals[i]->assertion;
+    const char *assertion = commandinfo->pvals[i].assertion;
     if (assertion && *assertion)
     {
       char *reading = edgex_value_tostring (values[i].value);
@@ -119,6 +432,7 @@ edgex_event_cooked *edgex_data_process_event
   eventId = edgex_device_genuuid ();
   result = malloc (sizeof (edgex_event_cooked));
   result->nrdgs = commandinfo->nreqs;
+  result->cbor = NULL;
 
   result->path = malloc (strlen (commandinfo->profile->name) + strlen (device_name) + strlen (commandinfo->name) + 3);
   strcpy (result->path, commandinfo->profile->name);
@@ -145,11 +459,19 @@ edgex_event_cooked *edgex_data_process_event
     switch (tc.type)
     {
       case IOT_DATA_BINARY:
-        iot_data_string_map_add (rmap, "binaryValue", iot_data_copy (values[i].value));
-        iot_data_string_map_add (rmap, "mediaType", iot_data_alloc_string (commandinfo->pvals[i]->mediaType, IOT_DATA_REF));
+        iot_data_string_map_add (rmap, "binaryValue", iot_data_add_ref (values[i].value));
+        iot_data_string_map_add (rmap, "mediaType", iot_data_alloc_string (commandinfo->pvals[i].mediaType, IOT_DATA_REF));
         break;
       case IOT_DATA_ARRAY:
-        iot_data_string_map_add (rmap, "value", iot_data_alloc_string (edgex_value_tostring (values[i].value), IOT_DATA_TAKE));
+        /* Arrays are carried by reference in CBOR events and only converted to text for JSON */
+        if (useCBOR)
+        {
+          iot_data_string_map_add (rmap, "value", iot_data_add_ref (values[i].value));
+        }
+        else
+        {
+          iot_data_string_map_add (rmap, "value", iot_data_alloc_string (edgex_value_tostring (values[i].value), IOT_DATA_TAKE));
+        }
         break;
       case IOT_DATA_MAP:
         iot_data_string_map_add (rmap, "objectValue", iot_data_copy (values[i].value));
@@ -186,10 +508,41 @@ void edgex_data_client_add_event (edgex_bus_t *client, edgex_event_cooked *ev, d
 {
   char *topic = edgex_bus_mktopic (client, EDGEX_DEV_TOPIC_EVENT, ev->path);
   edc_update_metrics (metrics, ev);
-  edgex_bus_post (client, topic, ev->value);
+  if (ev->encoding == CBOR)
+  {
+    iot_data_t *payload = edgex_event_cooked_cbor_flat (ev);
+    edgex_bus_post (client, topic, payload);
+    iot_data_free (payload);
+  }
+  else
+  {
+    edgex_bus_post (client, topic, ev->value);
+  }
   free (topic);
 }
 
+void edgex_data_client_add_events (edgex_bus_t *client, unsigned n, edgex_event_cooked **evs, devsdk_metrics_t *metrics)
+{
+  for (unsigned i = 0; i < n; i++)
+  {
+    if (evs[i])
+    {
+      edc_update_metrics (metrics, evs[i]);
+    }
+  }
+  for (unsigned i = 0; i < n; i++)
+  {
+    if (evs[i])
+    {
+      char *topic = edgex_bus_mktopic (client, EDGEX_DEV_TOPIC_EVENT, evs[i]->path);
+      iot_data_t *payload = (evs[i]->encoding == CBOR) ? edgex_event_cooked_cbor_flat (evs[i]) : iot_data_add_ref (evs[i]->value);
+      edgex_bus_post (client, topic, payload);
+      iot_data_free (payload);
+      free (topic);
+    }
+  }
+}
+
 size_t edgex_event_cooked_size (edgex_event_cooked *e)
 {
   size_t result;
@@ -201,14 +554,12 @@ size_t edgex_event_cooked_size (edgex_event_cooked *e)
   }
   else
   {
-    iot_data_t *cbor = iot_data_to_cbor (e->value);
-    result = iot_data_array_size (cbor);
-    iot_data_free (cbor);
+    result = edgex_event_cooked_cbor (e)->total;
   }
   return result;
 }
 
-void edgex_event_cooked_write (edgex_event_cooked *e, devsdk_http_reply *reply)
+void edgex_event_cooked_write (edgex_event_cooked *e, devsdk_http_reply *reply, uint64_t streamsize)
 {
   switch (e->encoding)
   {
@@ -222,12 +573,25 @@ void edgex_event_cooked_write (edgex_event_cooked *e, devsdk_http_reply *reply)
     }
     case CBOR:
     {
-      iot_data_t *cbor = iot_data_to_cbor (e->value);
-      reply->data.size = iot_data_array_size (cbor);
-      reply->data.bytes = malloc (reply->data.size);
-      memcpy (reply->data.bytes, iot_data_address (e->value), reply->data.size);
+      edgex_cbor_buf *cbor = edgex_event_cooked_cbor (e);
+      reply->data.size = cbor->total;
       reply->content_type = CONTENT_CBOR;
-      iot_data_free (cbor);
+      if (streamsize && cbor->total >= streamsize)
+      {
+        /* The encoding moves to the reply, which streams it out while holding a reference to the readings */
+        edgex_cbor_stream *st = malloc (sizeof (edgex_cbor_stream));
+        st->enc = cbor;
+        st->value = iot_data_add_ref (e->value);
+        e->cbor = NULL;
+        reply->stream = edgex_cbor_stream_read;
+        reply->stream_free = edgex_cbor_stream_free;
+        reply->stream_ctx = st;
+      }
+      else
+      {
+        reply->data.bytes = malloc (cbor->total);
+        edgex_cbor_read (cbor, 0, reply->data.bytes, cbor->total);
+      }
       break;
     }
   }
@@ -239,6 +603,7 @@ void edgex_event_cooked_free (edgex_event_cooked *e)
   if (e)
   {
     iot_data_free (e->value);
+    edgex_cbor_free (e->cbor);
     free (e->path);
     free (e);
   }
@@ -261,7 +626,7 @@ devsdk_commandresult *devsdk_commandresult_dup (const devsdk_commandresult *res,
   devsdk_commandresult *result = calloc (n, sizeof (devsdk_commandresult));
   for (int i = 0; i < n; i++)
   {
-    result[i].value = iot_data_copy (res[i].value);
+    result[i].value = iot_data_add_ref (res[i].value);
   }
   return result;
 }
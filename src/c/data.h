@@ -26,10 +26,13 @@ typedef struct edgex_event_cooked
   char *path;
   edgex_event_encoding encoding;
   iot_data_t *value;
+  struct edgex_cbor_buf *cbor;     // encoded form of value, for CBOR events
 } edgex_event_cooked;
 
 size_t edgex_event_cooked_size (edgex_event_cooked *e);
-void edgex_event_cooked_write (edgex_event_cooked *e, devsdk_http_reply *rep);
+
+/* CBOR replies of streamsize bytes or more are streamed rather than buffered; zero disables streaming */
+void edgex_event_cooked_write (edgex_event_cooked *e, devsdk_http_reply *rep, uint64_t streamsize);
 void edgex_event_cooked_free (edgex_event_cooked *e);
 
 edgex_event_cooked *edgex_data_process_event
@@ -42,6 +45,9 @@ edgex_event_cooked *edgex_data_process_event
 
 void edgex_data_client_add_event (edgex_bus_t *bus, edgex_event_cooked *eventval, devsdk_metrics_t *metrics);
 
+/* Post a batch of events; NULL entries are skipped */
+void edgex_data_client_add_events (edgex_bus_t *bus, unsigned n, edgex_event_cooked **events, devsdk_metrics_t *metrics);
+
 void devsdk_commandresult_free (devsdk_commandresult *res, int n);
 
 devsdk_commandresult *devsdk_commandresult_dup (const devsdk_commandresult *res, int n);
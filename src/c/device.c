@@ -13,6 +13,7 @@
 #include "parson.h"
 #include "data.h"
 #include "metadata.h"
+#include "lastconnected.h"
 #include "edgex-rest.h"
 #include "cmdinfo.h"
 #include "iot/base64.h"
@@ -21,6 +22,9 @@
 #include "reqdata.h"
 #include "request_auth.h"
 #include "opstate.h"
+#include "async.h"
+
+#include <iot/time.h>
 
 #include <inttypes.h>
 #include <string.h>
@@ -94,192 +98,379 @@ static iot_data_t *populateValue (iot_typecode_t rtype, const char *val)
 }
 
 static edgex_deviceresource *findDevResource
-  (edgex_deviceresource *list, const char *name)
+  (const edgex_cmdindex *idx, const char *name)
 {
-  while (list && strcmp (list->name, name))
-  {
-    list = list->next;
-  }
-  return list;
+  edgex_deviceresource **res = edgex_map_get_ ((edgex_map_base *)&idx->resources.base, name);
+  return res ? *res : NULL;
+}
+
+static void logException (devsdk_service_t *svc, iot_data_t *exception)
+{
+  char *exstr = iot_data_to_json (exception);
+  iot_log_error (svc->logger, "%s", exstr ? exstr : "Error: exstr reported NULL");
+  free (exstr);
+  iot_data_free (exception);
 }
 
-static edgex_cmdinfo *infoForRes (devsdk_service_t *svc, edgex_deviceprofile *prof, edgex_devicecommand *cmd, bool forGet)
+/* If attributes have already been parsed in bulk, the failed map holds the resources which could not be parsed */
+
+static bool parseAttributes (devsdk_service_t *svc, edgex_deviceresource *devres, edgex_map_void *failed)
 {
   iot_data_t *exception = NULL;
-  edgex_cmdinfo *result;
-  unsigned n = 0;
-  edgex_resourceoperation *ro;
-  edgex_deviceresource *devres;
-  for (ro = cmd->resourceOperations; ro; ro = ro->next)
+  if (failed)
   {
-    n++;
-    devres = findDevResource (prof->device_resources, ro->deviceResource);
-    if (devres->parsed_attrs == NULL)
-    {
-      devres->parsed_attrs = svc->userfns.create_res (svc->userdata, devres->attributes, &exception);
-      if (devres->parsed_attrs == NULL)
-      {
-        if (exception)
-        {
-          char *exstr = iot_data_to_json (exception);
-          iot_log_error (svc->logger, "%s", exstr ? exstr : "Error: exstr reported NULL");
-          free (exstr);
-          iot_data_free (exception);
-          iot_log_error (svc->logger, "Unable to parse attributes for device resource %s: device command %s will not be available", devres->name, cmd->name);
-          return NULL;
-        }
-      }
-    }
+    return edgex_map_get_ (&failed->base, devres->name) == NULL;
   }
-  result = malloc (sizeof (edgex_cmdinfo));
-  result->name = cmd->name;
-  result->profile = prof;
-  result->isget = forGet;
-  result->nreqs = n;
-  result->reqs = calloc (n, sizeof (devsdk_commandrequest));
-  result->pvals = calloc (n, sizeof (edgex_propertyvalue *));
-  result->maps = calloc (n, sizeof (iot_data_t *));
-  result->dfls = calloc (n, sizeof (char *));
-  for (n = 0, ro = cmd->resourceOperations; ro; n++, ro = ro->next)
+  if (devres->parsed_attrs == NULL)
   {
-    result->reqs[n].resource = malloc (sizeof (devsdk_resource_t));
-    edgex_deviceresource *devres =
-      findDevResource (prof->device_resources, ro->deviceResource);
-    result->reqs[n].resource->name = devres->name;
-    result->reqs[n].resource->attrs = devres->parsed_attrs;
-    result->reqs[n].resource->type = devres->properties->type;
-    if (devres->properties->mask.enabled)
+    devres->parsed_attrs = svc->userfns.create_res (svc->userdata, devres->attributes, &exception);
+    if (devres->parsed_attrs == NULL && exception)
     {
-      result->reqs[n].mask = ~devres->properties->mask.value.ival;
+      logException (svc, exception);
+      return false;
     }
-    result->pvals[n] = devres->properties;
-    result->maps[n] = iot_data_add_ref (ro->mappings);
-    if (ro->defaultValue && *ro->defaultValue)
+  }
+  return true;
+}
+
+static bool checkCommand (devsdk_service_t *svc, edgex_deviceprofile *prof, edgex_devicecommand *cmd, edgex_map_void *failed, unsigned *nreqs)
+{
+  *nreqs = 0;
+  for (edgex_resourceoperation *ro = cmd->resourceOperations; ro; ro = ro->next)
+  {
+    edgex_deviceresource *devres = findDevResource (prof->cmdindex, ro->deviceResource);
+    if (devres == NULL)
     {
-      result->dfls[n] = ro->defaultValue;
+      iot_log_error (svc->logger, "No device resource %s: device command %s will not be available", ro->deviceResource, cmd->name);
+      return false;
     }
-    else if (devres->properties->defaultvalue && *devres->properties->defaultvalue)
+    if (!parseAttributes (svc, devres, failed))
     {
-      result->dfls[n] = devres->properties->defaultvalue;
+      iot_log_error (svc->logger, "Unable to parse attributes for device resource %s: device command %s will not be available", devres->name, cmd->name);
+      return false;
     }
+    (*nreqs)++;
   }
-  result->next = NULL;
-  return result;
+  return true;
 }
 
-static edgex_cmdinfo *infoForDevRes (devsdk_service_t *svc, edgex_deviceprofile *prof, edgex_deviceresource *devres, bool forGet)
+static bool checkDevRes (devsdk_service_t *svc, edgex_deviceresource *devres, edgex_map_void *failed)
 {
-  edgex_cmdinfo *result;
-  iot_data_t *exception = NULL;
-  if (devres->parsed_attrs == NULL)
+  if (!parseAttributes (svc, devres, failed))
   {
-    devres->parsed_attrs = svc->userfns.create_res (svc->userdata, devres->attributes, &exception);
-    if (exception)
-    {
-      char *exstr = iot_data_to_json (exception);
-      iot_log_error (svc->logger, "%s", exstr ? exstr : "Error: exstr reported NULL");
-      free (exstr);
-      iot_data_free (exception);
-      iot_log_error (svc->logger, "Unable to parse attributes for device resource %s: it will not be available", devres->name);
-      return NULL;
-    }
+    iot_log_error (svc->logger, "Unable to parse attributes for device resource %s: it will not be available", devres->name);
+    return false;
   }
-  result = malloc (sizeof (edgex_cmdinfo));
-  result->name = devres->name;
-  result->profile = prof;
-  result->isget = forGet;
-  result->nreqs = 1;
-  result->reqs = malloc (sizeof (devsdk_commandrequest));
-  result->pvals = malloc (sizeof (edgex_propertyvalue *));
-  result->maps = malloc (sizeof (devsdk_nvpairs *));
-  result->dfls = malloc (sizeof (char *));
-  result->reqs[0].resource = malloc (sizeof (devsdk_resource_t));
-  result->reqs[0].resource->name = devres->name;
-  result->reqs[0].resource->attrs = devres->parsed_attrs;
-  result->reqs[0].resource->type = devres->properties->type;
+  return true;
+}
+
+typedef struct
+{
+  edgex_devicecommand *cmd;
+  edgex_deviceresource *devres;
+  bool isget;
+  unsigned nreqs;
+} edgex_cmdspec;
+
+static void addSpec (edgex_cmdspec *specs, unsigned *nspecs, unsigned *total, edgex_devicecommand *cmd, edgex_deviceresource *devres, bool isget, unsigned nreqs)
+{
+  specs[*nspecs].cmd = cmd;
+  specs[*nspecs].devres = devres;
+  specs[*nspecs].isget = isget;
+  specs[*nspecs].nreqs = nreqs;
+  (*nspecs)++;
+  *total += nreqs;
+}
+
+static void fillRequest (edgex_cmdinfo *info, unsigned n, devsdk_resource_t *res, const edgex_deviceresource *devres, const edgex_resourceoperation *ro)
+{
+  res->name = devres->name;
+  res->attrs = devres->parsed_attrs;
+  res->type = devres->properties->type;
+  info->reqs[n].resource = res;
   if (devres->properties->mask.enabled)
   {
-    result->reqs[0].mask = ~devres->properties->mask.value.ival;
+    info->reqs[n].mask = ~devres->properties->mask.value.ival;
   }
-  result->pvals[0] = devres->properties;
-  result->maps[0] = NULL;
-  if (devres->properties->defaultvalue && *devres->properties->defaultvalue)
+  info->pvals[n] = *devres->properties;
+  info->maps[n] = ro ? iot_data_add_ref (ro->mappings) : NULL;
+  if (ro && ro->defaultValue && *ro->defaultValue)
   {
-    result->dfls[0] = devres->properties->defaultvalue;
+    info->dfls[n] = ro->defaultValue;
   }
-  else
+  else if (devres->properties->defaultvalue && *devres->properties->defaultvalue)
   {
-    result->dfls[0] = NULL;
+    info->dfls[n] = devres->properties->defaultvalue;
+  }
+}
+
+static size_t cacheAlign (size_t n)
+{
+  return (n + EDGEX_CMDINFO_ALIGN - 1) & ~(size_t)(EDGEX_CMDINFO_ALIGN - 1);
+}
+
+static edgex_cmdinfo *buildCmdInfo (edgex_deviceprofile *prof, const edgex_cmdspec *specs, unsigned nspecs, unsigned total, size_t *blocksize)
+{
+  size_t reqsoff = cacheAlign (nspecs * sizeof (edgex_cmdinfo));
+  size_t resoff = reqsoff + cacheAlign (total * sizeof (devsdk_commandrequest));
+  size_t pvaloff = resoff + cacheAlign (total * sizeof (devsdk_resource_t));
+  size_t mapsoff = pvaloff + cacheAlign (total * sizeof (edgex_propertyvalue));
+  size_t dflsoff = mapsoff + cacheAlign (total * sizeof (iot_data_t *));
+  size_t size = dflsoff + cacheAlign (total * sizeof (char *));
+
+  char *block = aligned_alloc (EDGEX_CMDINFO_ALIGN, size);
+  memset (block, 0, size);
+  *blocksize = size;
+  edgex_cmdinfo *infos = (edgex_cmdinfo *)block;
+  devsdk_commandrequest *reqs = (devsdk_commandrequest *)(block + reqsoff);
+  devsdk_resource_t *res = (devsdk_resource_t *)(block + resoff);
+  edgex_propertyvalue *pvals = (edgex_propertyvalue *)(block + pvaloff);
+  iot_data_t **maps = (iot_data_t **)(block + mapsoff);
+  char **dfls = (char **)(block + dflsoff);
+
+  unsigned pos = 0;
+  for (unsigned i = 0; i < nspecs; i++)
+  {
+    edgex_cmdinfo *info = &infos[i];
+    info->name = specs[i].cmd ? specs[i].cmd->name : specs[i].devres->name;
+    info->profile = prof;
+    info->isget = specs[i].isget;
+    info->nreqs = specs[i].nreqs;
+    info->reqs = reqs + pos;
+    info->pvals = pvals + pos;
+    info->maps = maps + pos;
+    info->dfls = dfls + pos;
+    if (specs[i].cmd)
+    {
+      unsigned n = 0;
+      for (edgex_resourceoperation *ro = specs[i].cmd->resourceOperations; ro; ro = ro->next, n++)
+      {
+        fillRequest (info, n, res + pos + n, findDevResource (prof->cmdindex, ro->deviceResource), ro);
+      }
+    }
+    else
+    {
+      fillRequest (info, 0, res + pos, specs[i].devres, NULL);
+    }
+    info->next = (i + 1 < nspecs) ? &infos[i + 1] : NULL;
+    pos += info->nreqs;
+  }
+  return infos;
+}
+
+/* Parallel attribute parsing. Resources are claimed by index, so the calling thread and any
+ * pool threads which pick up the job share the work; the caller never depends on the pool
+ * to make progress. The job is freed by whichever of them drops the last reference.
+ */
+
+/* Upper bound on pool jobs submitted per profile, matches the service thread pool size */
+
+#define EDGEX_ATTR_WORKERS 8
+
+typedef struct edgex_attrjob
+{
+  devsdk_service_t *svc;
+  edgex_deviceresource **res;
+  iot_data_t **exceptions;
+  unsigned nres;
+  atomic_uint next;
+  atomic_uint done;
+  atomic_uint refs;
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+} edgex_attrjob;
+
+static void attrjob_run (edgex_attrjob *job)
+{
+  unsigned i;
+  while ((i = atomic_fetch_add (&job->next, 1)) < job->nres)
+  {
+    job->res[i]->parsed_attrs = job->svc->userfns.create_res (job->svc->userdata, job->res[i]->attributes, &job->exceptions[i]);
+    if (atomic_fetch_add (&job->done, 1) + 1 == job->nres)
+    {
+      pthread_mutex_lock (&job->mtx);
+      pthread_cond_signal (&job->cond);
+      pthread_mutex_unlock (&job->mtx);
+    }
   }
-  result->next = NULL;
-  return result;
 }
 
-static void insertCmdInfo (edgex_cmdinfo ***head, edgex_cmdinfo *entry)
+static void attrjob_release (edgex_attrjob *job)
 {
-  if (entry)
+  if (atomic_fetch_sub (&job->refs, 1) == 1)
   {
-    **head = entry;
-    *head = &((**head)->next);
+    pthread_cond_destroy (&job->cond);
+    pthread_mutex_destroy (&job->mtx);
+    free (job->res);
+    free (job->exceptions);
+    free (job);
   }
 }
 
-static void populateCmdInfo (devsdk_service_t *svc, edgex_deviceprofile *prof)
+static void *attrjob_worker (void *p)
+{
+  attrjob_run (p);
+  attrjob_release (p);
+  return NULL;
+}
+
+static void parseAllAttributes (devsdk_service_t *svc, edgex_deviceprofile *prof, edgex_map_void *failed)
 {
-  edgex_cmdinfo **head = &prof->cmdinfo;
-  edgex_devicecommand *cmd = prof->device_commands;
-  while (cmd)
+  unsigned n = 0;
+  unsigned nfailed = 0;
+  uint64_t start = iot_time_nsecs ();
+
+  for (edgex_deviceresource *devres = prof->device_resources; devres; devres = devres->next)
   {
-    if (cmd->readable)
+    n++;
+  }
+  edgex_attrjob *job = calloc (1, sizeof (edgex_attrjob));
+  job->svc = svc;
+  job->res = calloc (n ? n : 1, sizeof (edgex_deviceresource *));
+  job->exceptions = calloc (n ? n : 1, sizeof (iot_data_t *));
+  pthread_mutex_init (&job->mtx, NULL);
+  pthread_cond_init (&job->cond, NULL);
+  atomic_store (&job->refs, 1);
+  for (edgex_deviceresource *devres = prof->device_resources; devres; devres = devres->next)
+  {
+    if (devres->parsed_attrs == NULL)
     {
-      insertCmdInfo (&head, infoForRes (svc, prof, cmd, true));
+      job->res[job->nres++] = devres;
     }
-    if (cmd->writable)
+  }
+
+  for (unsigned i = 1; i < job->nres && i < EDGEX_ATTR_WORKERS; i++)
+  {
+    atomic_fetch_add (&job->refs, 1);
+    if (!iot_threadpool_try_work (svc->thpool, attrjob_worker, job, -1))
+    {
+      atomic_fetch_sub (&job->refs, 1);
+      break;
+    }
+  }
+  attrjob_run (job);
+  pthread_mutex_lock (&job->mtx);
+  while (atomic_load (&job->done) < job->nres)
+  {
+    pthread_cond_wait (&job->cond, &job->mtx);
+  }
+  pthread_mutex_unlock (&job->mtx);
+
+  for (unsigned i = 0; i < job->nres; i++)
+  {
+    if (job->res[i]->parsed_attrs == NULL && job->exceptions[i])
     {
-      insertCmdInfo (&head, infoForRes (svc, prof, cmd, false));
+      logException (svc, job->exceptions[i]);
+      edgex_map_set (failed, job->res[i]->name, NULL);
+      nfailed++;
     }
-    cmd = cmd->next;
   }
-  edgex_deviceresource *devres = prof->device_resources;
-  while (devres)
+  iot_log_info
+  (
+    svc->logger,
+    "Parsed attributes for %u device resources of profile %s in %" PRIu64 "us (%u failed)",
+    job->nres, prof->name, (iot_time_nsecs () - start) / 1000, nfailed
+  );
+  attrjob_release (job);
+}
+
+void edgex_deviceprofile_buildindex (devsdk_service_t *svc, edgex_deviceprofile *prof)
+{
+  if (prof->cmdindex)
+  {
+    return;
+  }
+  edgex_cmdindex *idx = calloc (1, sizeof (edgex_cmdindex));
+  edgex_map_init (&idx->getcmds);
+  edgex_map_init (&idx->setcmds);
+  edgex_map_init (&idx->resources);
+  prof->cmdindex = idx;
+
+  unsigned maxspecs = 0;
+  for (edgex_deviceresource *devres = prof->device_resources; devres; devres = devres->next)
+  {
+    edgex_map_set (&idx->resources, devres->name, devres);
+    maxspecs += 2;
+  }
+
+  edgex_map_void cmdnames;
+  edgex_map_init (&cmdnames);
+  edgex_map_void failures;
+  edgex_map_void *failed = NULL;
+  if (svc->config.device.parallelattrs)
+  {
+    edgex_map_init (&failures);
+    failed = &failures;
+    parseAllAttributes (svc, prof, failed);
+  }
+  for (edgex_devicecommand *cmd = prof->device_commands; cmd; cmd = cmd->next)
   {
-    edgex_devicecommand *dc;
-    for (dc = prof->device_commands; dc; dc = dc->next)
+    maxspecs += 2;
+  }
+  edgex_cmdspec *specs = calloc (maxspecs ? maxspecs : 1, sizeof (edgex_cmdspec));
+  unsigned nspecs = 0;
+  unsigned total = 0;
+
+  for (edgex_devicecommand *cmd = prof->device_commands; cmd; cmd = cmd->next)
+  {
+    unsigned nreqs;
+    edgex_map_set (&cmdnames, cmd->name, cmd);
+    if ((cmd->readable || cmd->writable) && checkCommand (svc, prof, cmd, failed, &nreqs))
     {
-      if (strcmp (dc->name, devres->name) == 0)
+      if (cmd->readable)
       {
-        break;
+        addSpec (specs, &nspecs, &total, cmd, NULL, true, nreqs);
+      }
+      if (cmd->writable)
+      {
+        addSpec (specs, &nspecs, &total, cmd, NULL, false, nreqs);
       }
     }
-    if (dc == NULL)
+  }
+  for (edgex_deviceresource *devres = prof->device_resources; devres; devres = devres->next)
+  {
+    bool rd = devres->properties->readable;
+    bool wr = devres->properties->writable;
+    if (edgex_map_get (&cmdnames, devres->name) == NULL && (rd || wr) && checkDevRes (svc, devres, failed))
     {
-      if (devres->properties->readable)
+      if (rd)
       {
-        insertCmdInfo (&head, infoForDevRes (svc, prof, devres, true));
+        addSpec (specs, &nspecs, &total, NULL, devres, true, 1);
       }
-      if (devres->properties->writable)
+      if (wr)
       {
-        insertCmdInfo (&head, infoForDevRes (svc, prof, devres, false));
+        addSpec (specs, &nspecs, &total, NULL, devres, false, 1);
       }
     }
-    devres = devres->next;
   }
+  edgex_map_deinit (&cmdnames);
+  if (failed)
+  {
+    edgex_map_deinit (failed);
+  }
+
+  if (nspecs)
+  {
+    prof->cmdinfo = buildCmdInfo (prof, specs, nspecs, total, &idx->infosize);
+    for (edgex_cmdinfo *info = prof->cmdinfo; info; info = info->next)
+    {
+      edgex_map_set (info->isget ? &idx->getcmds : &idx->setcmds, info->name, info);
+    }
+  }
+  free (specs);
 }
 
 const edgex_cmdinfo *edgex_deviceprofile_findcommand
   (devsdk_service_t *svc, const char *name, edgex_deviceprofile *prof, bool forGet)
 {
-  if (prof->cmdinfo == NULL)
+  edgex_cmdinfo **result = NULL;
+  if (prof->cmdindex)
   {
-    populateCmdInfo (svc, prof);
+    /* Call edgex_map_get_ directly as the edgex_map_get macro writes to the map */
+    edgex_map_cmdinfo *cmds = forGet ? &prof->cmdindex->getcmds : &prof->cmdindex->setcmds;
+    result = edgex_map_get_ (&cmds->base, name);
   }
-
-  edgex_cmdinfo *result = prof->cmdinfo;
-  while (result && (strcmp (result->name, name) || forGet != result->isget))
-  {
-    result = result->next;
-  }
-  return result;
+  return result ? *result : NULL;
 }
 
 static void edgex_device_runput2
@@ -290,13 +481,13 @@ static void edgex_device_runput2
   for (int i = 0; i < cmdinfo->nreqs; i++)
   {
     const char *resname = cmdinfo->reqs[i].resource->name;
-    if (!cmdinfo->pvals[i]->writable)
+    if (!cmdinfo->pvals[i].writable)
     {
       edgex_error_response (svc->logger, reply, MHD_HTTP_METHOD_NOT_ALLOWED, "Attempt to write unwritable value %s", resname);
       break;
     }
 
-    if (cmdinfo->pvals[i]->type.type != IOT_DATA_BINARY)
+    if (cmdinfo->pvals[i].type.type != IOT_DATA_BINARY)
     {
       const char *value = edgex_reqdata_get (rdata, resname, cmdinfo->dfls[i]);
       if (value == NULL)
@@ -305,7 +496,7 @@ static void edgex_device_runput2
         break;
       }
 
-      results[i] = populateValue (cmdinfo->pvals[i]->type, value);
+      results[i] = populateValue (cmdinfo->pvals[i].type, value);
       if (!results[i])
       {
         edgex_error_response (svc->logger, reply, MHD_HTTP_BAD_REQUEST, "Unable to parse \"%s\" for %s", value ? value : cmdinfo->dfls[i], resname);
@@ -314,12 +505,12 @@ static void edgex_device_runput2
 
       if (svc->config.device.datatransform)
       {
-        if (!edgex_transform_validate (results[i], cmdinfo->pvals[i]))
+        if (!edgex_transform_validate (results[i], &cmdinfo->pvals[i]))
         {
           edgex_error_response (svc->logger, reply, MHD_HTTP_BAD_REQUEST, "Value \"%s\" for %s out of range specified in profile", value, resname);
           break;
         }
-        edgex_transform_incoming (&results[i], cmdinfo->pvals[i], cmdinfo->maps[i]);
+        edgex_transform_incoming (&results[i], &cmdinfo->pvals[i], cmdinfo->maps[i]);
         if (!results[i])
         {
           edgex_error_response (svc->logger, reply, MHD_HTTP_BAD_REQUEST, "Value \"%s\" for %s overflows after transformations", value, resname);
@@ -346,15 +537,14 @@ static void edgex_device_runput2
     }
     if (dev->devimpl->address)
     {
-      if (svc->userfns.puthandler (svc->userdata, dev->devimpl, cmdinfo->nreqs, cmdinfo->reqs, (const iot_data_t **)results, params, &e))
+      if (edgex_device_put (svc, dev, cmdinfo->profile, cmdinfo->nreqs, cmdinfo->reqs, (const iot_data_t **)results, params, &e))
       {
         edgex_baseresponse br;
         edgex_baseresponse_populate (&br, EDGEX_API_VERSION, MHD_HTTP_OK, "Data written successfully");
         edgex_baseresponse_write (&br, reply);
         if (svc->config.device.updatelastconnected)
         {
-          devsdk_error err;
-          edgex_metadata_client_update_lastconnected (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, &err);
+          edgex_lcwriter_note (svc->lcwriter, dev);
         }
       }
       else
@@ -387,7 +577,7 @@ static edgex_event_cooked *edgex_device_runget2
 {
   for (int i = 0; i < cmdinfo->nreqs; i++)
   {
-    if (!cmdinfo->pvals[i]->readable)
+    if (!cmdinfo->pvals[i].readable)
     {
       edgex_error_response (svc->logger, reply, MHD_HTTP_METHOD_NOT_ALLOWED, "Attempt to read unreadable value %s", cmdinfo->reqs[i].resource->name);
       return NULL;
@@ -404,16 +594,15 @@ static edgex_event_cooked *edgex_device_runget2
   }
   if (dev->devimpl->address)
   {
-    if (svc->userfns.gethandler (svc->userdata, dev->devimpl, cmdinfo->nreqs, cmdinfo->reqs, results, params, &e))
+    if (edgex_device_get (svc, dev, cmdinfo->profile, cmdinfo->nreqs, cmdinfo->reqs, results, params, &e))
     {
-      devsdk_error err = EDGEX_OK;
       result = edgex_data_process_event (dev->name, cmdinfo, results, svc->config.device.datatransform);
 
       if (result)
       {
         if (svc->config.device.updatelastconnected)
         {
-          edgex_metadata_client_update_lastconnected (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, &err);
+          edgex_lcwriter_note (svc->lcwriter, dev);
         }
         if (svc->config.device.maxeventsize && edgex_event_cooked_size (result) > svc->config.device.maxeventsize * 1024)
         {
@@ -425,7 +614,7 @@ static edgex_event_cooked *edgex_device_runget2
       else
       {
         edgex_error_response (svc->logger, reply, MHD_HTTP_INTERNAL_SERVER_ERROR, "Assertion failed for device %s. Marking as down.", dev->name);
-        edgex_metadata_client_set_device_opstate (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, DOWN, &err);
+        devsdk_queue_device_opstate (svc, dev->name, false);
       }
     }
     else
@@ -453,12 +642,13 @@ static edgex_event_cooked *edgex_device_runget2
 static void edgex_device_v2impl (devsdk_service_t *svc, edgex_device *dev, const devsdk_http_request *req, devsdk_http_reply *reply)
 {
   const char *cmdname = devsdk_nvpairs_value (req->params, "cmd");
-  const edgex_cmdinfo *cmd = edgex_deviceprofile_findcommand (svc, cmdname, dev->profile, req->method == DevSDK_Get);
+  edgex_deviceprofile *profile = edgex_devmap_device_profile (svc->devices, dev);
+  const edgex_cmdinfo *cmd = edgex_deviceprofile_findcommand (svc, cmdname, profile, req->method == DevSDK_Get);
   reply->code = MHD_HTTP_OK;
 
   if (!cmd)
   {
-    if (edgex_deviceprofile_findcommand (svc, cmdname, dev->profile, req->method != DevSDK_Get))
+    if (edgex_deviceprofile_findcommand (svc, cmdname, profile, req->method != DevSDK_Get))
     {
       edgex_error_response (svc->logger, reply, MHD_HTTP_METHOD_NOT_ALLOWED, "Wrong method for command %s (operation is %s-only)", cmdname, req->method == DevSDK_Get ? "write" : "read");
     }
@@ -508,7 +698,7 @@ static void edgex_device_v2impl (devsdk_service_t *svc, edgex_device *dev, const
           if (retv)
           {
             edgex_data_client_add_event (svc->msgbus, event, &svc->metrics);
-            edgex_event_cooked_write (event, reply);
+            edgex_event_cooked_write (event, reply, svc->config.service.streamsize);
           }
           else
           {
@@ -522,7 +712,7 @@ static void edgex_device_v2impl (devsdk_service_t *svc, edgex_device *dev, const
         {
           if (retv)
           {
-            edgex_event_cooked_write (event, reply);
+            edgex_event_cooked_write (event, reply, svc->config.service.streamsize);
           }
           else
           {
@@ -559,6 +749,7 @@ static void edgex_device_v2impl (devsdk_service_t *svc, edgex_device *dev, const
   {
     edgex_device_release (svc, dev);
   }
+  edgex_deviceprofile_release (svc, profile);
 }
 
 void edgex_device_handler_device_namev2 (void *ctx, const devsdk_http_request *req, devsdk_http_reply *reply)
@@ -594,7 +785,7 @@ static int32_t edgex_device_runput3
   for (int i = 0; i < cmdinfo->nreqs; i++)
   {
     const char *resname = cmdinfo->reqs[i].resource->name;
-    if (!cmdinfo->pvals[i]->writable)
+    if (!cmdinfo->pvals[i].writable)
     {
       *reply = edgex_v3_error_response (svc->logger, "Attempt to write unwritable value %s", resname);
       result = MHD_HTTP_METHOD_NOT_ALLOWED;
@@ -609,7 +800,7 @@ static int32_t edgex_device_runput3
       break;
     }
 
-    results[i] = populateValue (cmdinfo->pvals[i]->type, value);
+    results[i] = populateValue (cmdinfo->pvals[i].type, value);
     if (!results[i])
     {
       *reply = edgex_v3_error_response (svc->logger, "Unable to parse \"%s\" for %s", value, resname);
@@ -619,13 +810,13 @@ static int32_t edgex_device_runput3
 
     if (svc->config.device.datatransform)
     {
-      if (!edgex_transform_validate (results[i], cmdinfo->pvals[i]))
+      if (!edgex_transform_validate (results[i], &cmdinfo->pvals[i]))
       {
         *reply = edgex_v3_error_response (svc->logger, "Value \"%s\" for %s out of range specified in profile", value, resname);
         result = MHD_HTTP_BAD_REQUEST;
         break;
       }
-      edgex_transform_incoming (&results[i], cmdinfo->pvals[i], cmdinfo->maps[i]);
+      edgex_transform_incoming (&results[i], &cmdinfo->pvals[i], cmdinfo->maps[i]);
       if (!results[i])
       {
         *reply = edgex_v3_error_response (svc->logger, "Value \"%s\" for %s overflows after transformations", value, resname);
@@ -646,13 +837,12 @@ static int32_t edgex_device_runput3
   }
   if (dev->devimpl->address)
   {
-    if (svc->userfns.puthandler (svc->userdata, dev->devimpl, cmdinfo->nreqs, cmdinfo->reqs, (const iot_data_t **)results, params, &e))
+    if (edgex_device_put (svc, dev, cmdinfo->profile, cmdinfo->nreqs, cmdinfo->reqs, (const iot_data_t **)results, params, &e))
     {
       *reply = edgex_v3_base_response ("Data written successfully");
       if (svc->config.device.updatelastconnected)
       {
-        devsdk_error err;
-        edgex_metadata_client_update_lastconnected (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, &err);
+        edgex_lcwriter_note (svc->lcwriter, dev);
       }
       devsdk_device_request_succeeded (svc, dev);
     }
@@ -686,7 +876,7 @@ static edgex_event_cooked *edgex_device_runget3 (devsdk_service_t *svc, edgex_de
 {
   for (int i = 0; i < cmdinfo->nreqs; i++)
   {
-    if (!cmdinfo->pvals[i]->readable)
+    if (!cmdinfo->pvals[i].readable)
     {
       *reply = edgex_v3_error_response (svc->logger, "Attempt to read unreadable value %s", cmdinfo->reqs[i].resource->name);
       return NULL;
@@ -703,15 +893,14 @@ static edgex_event_cooked *edgex_device_runget3 (devsdk_service_t *svc, edgex_de
   }
   if (dev->devimpl->address)
   {
-    if (svc->userfns.gethandler (svc->userdata, dev->devimpl, cmdinfo->nreqs, cmdinfo->reqs, results, params, &e))
+    if (edgex_device_get (svc, dev, cmdinfo->profile, cmdinfo->nreqs, cmdinfo->reqs, results, params, &e))
     {
-      devsdk_error err = EDGEX_OK;
       result = edgex_data_process_event (dev->name, cmdinfo, results, svc->config.device.datatransform);
       if (result)
       {
         if (svc->config.device.updatelastconnected)
         {
-          edgex_metadata_client_update_lastconnected (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, &err);
+          edgex_lcwriter_note (svc->lcwriter, dev);
         }
         if (svc->config.device.maxeventsize && edgex_event_cooked_size (result) > svc->config.device.maxeventsize * 1024)
         {
@@ -724,7 +913,7 @@ static edgex_event_cooked *edgex_device_runget3 (devsdk_service_t *svc, edgex_de
       else
       {
         *reply = edgex_v3_error_response (svc->logger, "Assertion failed for device %s. Marking as down.", dev->name);
-        edgex_metadata_client_set_device_opstate (svc->logger, &svc->config.endpoints, svc->secretstore, dev->name, DOWN, &err);
+        devsdk_queue_device_opstate (svc, dev->name, false);
       }
     }
     else
@@ -751,10 +940,11 @@ static edgex_event_cooked *edgex_device_runget3 (devsdk_service_t *svc, edgex_de
 static int32_t edgex_device_v3impl (devsdk_service_t *svc, edgex_device *dev, const char *cmdname, bool isGet, const iot_data_t *req, const iot_data_t *params, iot_data_t **reply)
 {
   int32_t result = 0;
-  const edgex_cmdinfo *cmd = edgex_deviceprofile_findcommand (svc, cmdname, dev->profile, isGet);
+  edgex_deviceprofile *profile = edgex_devmap_device_profile (svc->devices, dev);
+  const edgex_cmdinfo *cmd = edgex_deviceprofile_findcommand (svc, cmdname, profile, isGet);
   if (!cmd)
   {
-    if (edgex_deviceprofile_findcommand (svc, cmdname, dev->profile, !isGet))
+    if (edgex_deviceprofile_findcommand (svc, cmdname, profile, !isGet))
     {
       *reply = edgex_v3_error_response (svc->logger, "Wrong method for command %s (operation is %s-only)", cmdname, isGet ? "write" : "read");
       result = MHD_HTTP_METHOD_NOT_ALLOWED;
@@ -783,6 +973,7 @@ static int32_t edgex_device_v3impl (devsdk_service_t *svc, edgex_device *dev, co
   if (result)
   {
     edgex_device_release (svc, dev);
+    edgex_deviceprofile_release (svc, profile);
     return result;
   }
 
@@ -818,6 +1009,7 @@ static int32_t edgex_device_v3impl (devsdk_service_t *svc, edgex_device *dev, co
     result = edgex_device_runput3 (svc, dev, cmd, req, params, reply);
     edgex_device_release (svc, dev);
   }
+  edgex_deviceprofile_release (svc, profile);
   return result;
 }
 
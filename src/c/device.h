@@ -18,6 +18,8 @@ extern void edgex_device_handler_device_namev2 (void *ctx, const devsdk_http_req
 
 extern int32_t edgex_device_handler_devicev3 (void *ctx, const iot_data_t *req, const iot_data_t *pathparams, const iot_data_t *params, iot_data_t **reply);
 
+extern void edgex_deviceprofile_buildindex (devsdk_service_t *svc, edgex_deviceprofile *prof);
+
 extern const struct edgex_cmdinfo *edgex_deviceprofile_findcommand
   (devsdk_service_t *svc, const char *name, edgex_deviceprofile *prof, bool forGet);
 
@@ -12,6 +12,7 @@
 #include "edgex-rest.h"
 #include "errorlist.h"
 #include "devutil.h"
+#include "intern.h"
 #include "edgex/devices.h"
 #include "edgex/profiles.h"
 
@@ -36,7 +37,7 @@ void devsdk_free_devices (devsdk_service_t *svc, devsdk_devices *d)
 {
   while (d)
   {
-    free (d->device->name);
+    edgex_intern_release (d->device->name);
     svc->userfns.free_addr (svc->userdata, d->device->address);
     free (d->device);
     devsdk_free_resources (d->resources);
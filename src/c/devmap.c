@@ -16,6 +16,7 @@
 #include "edgex-rest.h"
 #include "device.h"
 #include "autoevent.h"
+#include "cmdinfo.h"
 
 typedef edgex_map(edgex_device *) edgex_map_device;
 typedef edgex_map(edgex_deviceprofile *) edgex_map_profile;
@@ -26,6 +27,7 @@ struct edgex_devmap_t
   edgex_map_device devices;
   edgex_map_profile profiles;
   devsdk_service_t *svc;
+  atomic_uint_fast64_t generation;
 };
 
 edgex_devmap_t *edgex_devmap_alloc (devsdk_service_t *svc)
@@ -46,6 +48,7 @@ edgex_devmap_t *edgex_devmap_alloc (devsdk_service_t *svc)
   edgex_map_init (&res->devices);
   edgex_map_init (&res->profiles);
   res->svc = svc;
+  atomic_store (&res->generation, 0);
   return res;
 }
 
@@ -65,6 +68,7 @@ void edgex_devmap_clear (edgex_devmap_t *map)
     edgex_map_remove (&map->devices, key);
     key = next;
   }
+  atomic_fetch_add (&map->generation, 1);
   pthread_rwlock_unlock (&map->lock);
 }
 
@@ -76,7 +80,7 @@ void edgex_devmap_free (edgex_devmap_t *map)
   while ((key = edgex_map_next (&map->profiles, &i)))
   {
     edgex_deviceprofile **p = edgex_map_get (&map->profiles, key);
-    edgex_deviceprofile_free (map->svc, *p);
+    edgex_deviceprofile_release (map->svc, *p);
   }
   edgex_map_deinit (&map->profiles);
   pthread_rwlock_destroy (&map->lock);
@@ -88,6 +92,8 @@ static void add_locked (edgex_devmap_t *map, const edgex_device *newdev, int32_t
   edgex_device *dup = edgex_device_dup (newdev);
   atomic_store (&dup->refs, 1);
   atomic_store (&dup->retries, retries);
+  atomic_store (&dup->lastconnected, 0);
+  dup->lcnext = NULL;
   dup->ownprofile = false;
   edgex_deviceprofile **pp = edgex_map_get (&map->profiles, dup->profile->name);
   if (pp)
@@ -97,9 +103,11 @@ static void add_locked (edgex_devmap_t *map, const edgex_device *newdev, int32_t
   }
   else
   {
+    edgex_deviceprofile_buildindex (map->svc, dup->profile);
     edgex_map_set (&map->profiles, dup->profile->name, dup->profile);
   }
   edgex_map_set (&map->devices, dup->name, dup);
+  atomic_fetch_add (&map->generation, 1);
   edgex_device_autoevent_start (map->svc, dup);
 }
 
@@ -171,6 +179,103 @@ edgex_deviceprofile *edgex_devmap_copyprofiles (edgex_devmap_t *map)
   return result;
 }
 
+static size_t strsize (const char *s)
+{
+  return s ? strlen (s) + 1 : 0;
+}
+
+static size_t strings_memory (const devsdk_strings *s)
+{
+  size_t result = 0;
+  for (; s; s = s->next)
+  {
+    result += sizeof (devsdk_strings) + strsize (s->str);
+  }
+  return result;
+}
+
+static size_t device_memory (const edgex_device *dev)
+{
+  size_t result = sizeof (edgex_device) + sizeof (devsdk_device_t);
+  result += strsize (dev->description) + strings_memory (dev->labels);
+  for (const devsdk_protocols *p = dev->protocols; p; p = p->next)
+  {
+    result += sizeof (devsdk_protocols);
+  }
+  return result;
+}
+
+static size_t propertyvalue_memory (const edgex_propertyvalue *pv)
+{
+  return sizeof (edgex_propertyvalue) + strsize (pv->units) + strsize (pv->defaultvalue) + strsize (pv->assertion) + strsize (pv->mediaType);
+}
+
+static size_t profile_memory (const edgex_deviceprofile *prof)
+{
+  size_t result = sizeof (edgex_deviceprofile);
+  result += strsize (prof->description) + strsize (prof->manufacturer) + strsize (prof->model) + strings_memory (prof->labels);
+  for (const edgex_deviceresource *r = prof->device_resources; r; r = r->next)
+  {
+    result += sizeof (edgex_deviceresource) + strsize (r->description) + strsize (r->tag) + propertyvalue_memory (r->properties);
+  }
+  for (const edgex_devicecommand *c = prof->device_commands; c; c = c->next)
+  {
+    result += sizeof (edgex_devicecommand);
+    for (const edgex_resourceoperation *ro = c->resourceOperations; ro; ro = ro->next)
+    {
+      result += sizeof (edgex_resourceoperation) + strsize (ro->deviceResource) + strsize (ro->defaultValue);
+    }
+  }
+  if (prof->cmdindex)
+  {
+    result += sizeof (edgex_cmdindex) + prof->cmdindex->infosize;
+  }
+  return result;
+}
+
+void edgex_devmap_memory (edgex_devmap_t *map, edgex_devmap_memstats *stats)
+{
+  const char *key;
+  memset (stats, 0, sizeof (*stats));
+
+  pthread_rwlock_rdlock (&map->lock);
+  edgex_map_iter iter = edgex_map_iter (map->devices);
+  while ((key = edgex_map_next (&map->devices, &iter)))
+  {
+    const edgex_device *dev = *(edgex_device **)edgex_map_get_ (&map->devices.base, key);
+    stats->devices++;
+    stats->devicebytes += device_memory (dev);
+    for (const edgex_device_autoevents *ae = dev->autos; ae; ae = ae->next)
+    {
+      stats->autoevents++;
+      stats->autoeventbytes += edgex_device_autoevent_memory (ae);
+    }
+  }
+  iter = edgex_map_iter (map->profiles);
+  while ((key = edgex_map_next (&map->profiles, &iter)))
+  {
+    stats->profiles++;
+    stats->profilebytes += profile_memory (*(edgex_deviceprofile **)edgex_map_get_ (&map->profiles.base, key));
+  }
+  pthread_rwlock_unlock (&map->lock);
+}
+
+void edgex_devmap_autoevents (edgex_devmap_t *map, edgex_devmap_aevisitor fn, void *ctx)
+{
+  const char *key;
+  pthread_rwlock_rdlock (&map->lock);
+  edgex_map_iter iter = edgex_map_iter (map->devices);
+  while ((key = edgex_map_next (&map->devices, &iter)))
+  {
+    const edgex_device *dev = *(edgex_device **)edgex_map_get_ (&map->devices.base, key);
+    for (const edgex_device_autoevents *ae = dev->autos; ae; ae = ae->next)
+    {
+      fn (ctx, dev, ae);
+    }
+  }
+  pthread_rwlock_unlock (&map->lock);
+}
+
 const edgex_deviceprofile *edgex_devmap_profile
   (edgex_devmap_t *map, const char *name)
 {
@@ -184,6 +289,7 @@ const edgex_deviceprofile *edgex_devmap_profile
 static void remove_locked (edgex_devmap_t *map, edgex_device *olddev)
 {
   edgex_map_remove (&map->devices, olddev->name);
+  atomic_fetch_add (&map->generation, 1);
 }
 
 static void release_profile_locked (edgex_devmap_t *map, edgex_device *olddev)
@@ -223,7 +329,7 @@ static bool update_in_place (edgex_device *dest, const edgex_device *src, edgex_
     *outcome = UPDATED_DRIVER;
     dest->adminState = src->adminState;
   }
-  if (strcmp (dest->profile->name, src->profile->name))
+  if (dest->profile->name != src->profile->name)
   {
     return false;
   }
@@ -264,7 +370,7 @@ edgex_devmap_outcome_t edgex_devmap_replace_device (edgex_devmap_t *map, const e
       remove_locked (map, olddev);
       add_locked (map, dev, olddev->retries);
       release = true;
-      if (strcmp (olddev->profile->name, dev->profile->name))
+      if (olddev->profile->name != dev->profile->name)
       {
         release_profile_locked (map, olddev);
       }
@@ -294,6 +400,36 @@ edgex_device *edgex_devmap_device_byname (edgex_devmap_t *map, const char *name)
   return result;
 }
 
+edgex_deviceprofile *edgex_devmap_device_profile (edgex_devmap_t *map, const edgex_device *dev)
+{
+  pthread_rwlock_rdlock (&map->lock);
+  edgex_deviceprofile *result = dev->profile;
+  edgex_deviceprofile_addref (result);
+  pthread_rwlock_unlock (&map->lock);
+  return result;
+}
+
+void edgex_devmap_rdlock (edgex_devmap_t *map)
+{
+  pthread_rwlock_rdlock (&map->lock);
+}
+
+void edgex_devmap_unlock (edgex_devmap_t *map)
+{
+  pthread_rwlock_unlock (&map->lock);
+}
+
+uint64_t edgex_devmap_generation (edgex_devmap_t *map)
+{
+  return atomic_load (&map->generation);
+}
+
+edgex_device *edgex_devmap_device_locked (edgex_devmap_t *map, const char *name)
+{
+  edgex_device **dev = edgex_map_get_ (&map->devices.base, name);
+  return dev ? *dev : NULL;
+}
+
 bool edgex_devmap_device_exists (edgex_devmap_t *map, const char *name)
 {
   bool result;
@@ -330,6 +466,7 @@ bool edgex_devmap_removedevice_byname (edgex_devmap_t *map, const char *name)
 
 void edgex_devmap_add_profile (edgex_devmap_t *map, edgex_deviceprofile *dp)
 {
+  edgex_deviceprofile_buildindex (map->svc, dp);
   pthread_rwlock_wrlock (&map->lock);
   edgex_map_set (&map->profiles, dp->name, dp);
   pthread_rwlock_unlock (&map->lock);
@@ -337,6 +474,7 @@ void edgex_devmap_add_profile (edgex_devmap_t *map, edgex_deviceprofile *dp)
 
 void edgex_devmap_update_profile (devsdk_service_t *svc, edgex_deviceprofile *dp)
 {
+  edgex_deviceprofile_buildindex (svc, dp);
   pthread_rwlock_wrlock (&svc->devices->lock);
   edgex_deviceprofile **oldp = edgex_map_get (&svc->devices->profiles, dp->name);
   if (oldp)
@@ -356,7 +494,8 @@ void edgex_devmap_update_profile (devsdk_service_t *svc, edgex_deviceprofile *dp
     }
 
     edgex_map_remove (&svc->devices->profiles, dp->name);
-    edgex_deviceprofile_free (svc, old);
+    edgex_deviceprofile_release (svc, old);
+    atomic_fetch_add (&svc->devices->generation, 1);
   }
   edgex_map_set (&svc->devices->profiles, dp->name, dp);
   pthread_rwlock_unlock (&svc->devices->lock);
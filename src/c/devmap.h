@@ -57,6 +57,28 @@ extern edgex_devmap_outcome_t edgex_devmap_replace_device
 extern edgex_device *edgex_devmap_device_byname
   (edgex_devmap_t *map, const char *name);
 
+/*
+ * The current profile of a referenced device. A profile update replaces the profile of
+ * its devices, so a command looked up for a device is only valid while a reference on
+ * the profile it came from is held. Release with edgex_deviceprofile_release().
+ */
+
+extern edgex_deviceprofile *edgex_devmap_device_profile
+  (edgex_devmap_t *map, const edgex_device *dev);
+
+/*
+ * Locked access for callers which cache lookups. The generation changes whenever a
+ * device is added, replaced or removed, or a profile is replaced, so a device or command
+ * looked up under the read lock remains valid while the generation is unchanged
+ * and the read lock is held. Devices returned by edgex_devmap_device_locked are
+ * not referenced and must not be released.
+ */
+
+extern void edgex_devmap_rdlock (edgex_devmap_t *map);
+extern void edgex_devmap_unlock (edgex_devmap_t *map);
+extern uint64_t edgex_devmap_generation (edgex_devmap_t *map);
+extern edgex_device *edgex_devmap_device_locked (edgex_devmap_t *map, const char *name);
+
 /*
  * Release function. The device is freed when its reference count hits zero.
  */
@@ -70,10 +92,35 @@ extern void edgex_device_release (devsdk_service_t *svc, edgex_device *dev);
 extern bool edgex_devmap_removedevice_byname
   (edgex_devmap_t *map, const char *name);
 
+/*
+ * Approximate heap usage of the devices and profiles held in the map. Interned
+ * names are accounted for separately, and the contents of iot_data values
+ * (protocol properties, attributes, mappings) are not included.
+ */
+
+typedef struct edgex_devmap_memstats
+{
+  size_t devices;
+  size_t devicebytes;
+  size_t autoevents;
+  size_t autoeventbytes;
+  size_t profiles;
+  size_t profilebytes;
+} edgex_devmap_memstats;
+
+extern void edgex_devmap_memory (edgex_devmap_t *map, edgex_devmap_memstats *stats);
+
+/* Visit the autoevents of every device. The map is read-locked during the walk */
+
+typedef void (*edgex_devmap_aevisitor) (void *ctx, const edgex_device *dev, const edgex_device_autoevents *ae);
+
+extern void edgex_devmap_autoevents (edgex_devmap_t *map, edgex_devmap_aevisitor fn, void *ctx);
+
 /*
  * Add and retrieve profiles. We take ownership on add, and return pointers
  * to the profiles held in the implementation. Unlike devices these are not
- * refcounted and do not need to be released or freed.
+ * refcounted and do not need to be released or freed. The command index of
+ * a profile is built as it is added.
  */
 
 extern void edgex_devmap_add_profile
@@ -10,6 +10,7 @@
 #include "devsdk/devsdk.h"
 #include "devutil.h"
 #include "service.h"
+#include "intern.h"
 
 devsdk_strings *devsdk_strings_new (const char *str, devsdk_strings *list)
 {
@@ -121,7 +122,7 @@ bool devsdk_nvpairs_float_value (const devsdk_nvpairs *nvp, const char *name, fl
 devsdk_protocols *devsdk_protocols_new (const char *name, const iot_data_t *properties, devsdk_protocols *list)
 {
   devsdk_protocols *result = malloc (sizeof (devsdk_protocols));
-  result->name = strdup (name);
+  result->name = edgex_intern (name);
   result->properties = iot_data_copy (properties);
   result->next = list;
   return result;
@@ -196,6 +197,18 @@ void devsdk_callbacks_set_autoevent_handlers (devsdk_callbacks *cb, devsdk_autoe
   cb->ae_stopper = ae_stopper;
 }
 
+void devsdk_callbacks_set_batch_reader (devsdk_callbacks *cb, devsdk_connection_key conn_key, devsdk_handle_get_batch get_batch)
+{
+  cb->conn_key = conn_key;
+  cb->get_batch = get_batch;
+}
+
+void devsdk_callbacks_set_async_handlers (devsdk_callbacks *cb, devsdk_handle_get_async get_async, devsdk_handle_put_async put_async)
+{
+  cb->get_async = get_async;
+  cb->put_async = put_async;
+}
+
 void devsdk_callbacks_set_validate_addr (devsdk_callbacks *cb, devsdk_validate_address validate_addr)
 {
   cb->validate_addr = validate_addr;
@@ -266,14 +279,16 @@ bool TYPENAME ## _equal (const TYPENAME *l1, const TYPENAME *l2)  \
 
 static bool protocol_equal (const devsdk_protocols *p1, const devsdk_protocols *p2)
 {
-  return iot_data_equal (p1->properties, p2->properties);
+  return p1->properties == p2->properties || iot_data_equal (p1->properties, p2->properties);
 }
 
 LIST_EQUAL_FUNCTION(devsdk_protocols, name, protocol_equal)
 
 static bool autoevent_equal (const edgex_device_autoevents *e1, const edgex_device_autoevents *e2)
 {
-  return strcmp (e1->interval, e2->interval) == 0 && e1->onChange == e2->onChange;
+  return strcmp (e1->interval, e2->interval) == 0 && e1->onChange == e2->onChange &&
+    e1->onChangeThreshold == e2->onChangeThreshold && e1->onChangePercent == e2->onChangePercent &&
+    e1->onChangeHysteresis == e2->onChangeHysteresis;
 }
 
 LIST_EQUAL_FUNCTION(edgex_device_autoevents, resource, autoevent_equal)
@@ -8,6 +8,9 @@
 
 #include "dto-read.h"
 #include "devutil.h"
+#include "intern.h"
+
+#include <iot/time.h>
 
 static char *get_string_dfl (const iot_data_t *obj, const char *name, const char *dfl)
 {
@@ -20,6 +23,12 @@ static char *get_string (const iot_data_t *obj, const char *name)
   return get_string_dfl (obj, name, "");
 }
 
+static char *get_name (const iot_data_t *obj, const char *name)
+{
+  const char *str = iot_data_string_map_get_string (obj, name);
+  return edgex_intern (str ? str : "");
+}
+
 edgex_device_adminstate edgex_adminstate_read (const iot_data_t *obj)
 {
   const char *c = iot_data_string (obj);
@@ -42,7 +51,7 @@ static devsdk_protocols *edgex_protocols_read (const iot_data_t *obj)
     while (iot_data_map_iter_next (&iter))
     {
       devsdk_protocols *prot = malloc (sizeof (devsdk_protocols));
-      prot->name = strdup (iot_data_map_iter_string_key (&iter));
+      prot->name = edgex_intern (iot_data_map_iter_string_key (&iter));
       prot->properties = iot_data_add_ref (iot_data_map_iter_value (&iter));
       prot->next = result;
       result = prot;
@@ -54,9 +63,13 @@ static devsdk_protocols *edgex_protocols_read (const iot_data_t *obj)
 static edgex_device_autoevents *edgex_autoevent_read (const iot_data_t *obj)
 {
   edgex_device_autoevents *result = calloc (1, sizeof (edgex_device_autoevents));
-  result->resource = get_string (obj, "sourceName");
+  result->resource = get_name (obj, "sourceName");
   result->onChange = iot_data_string_map_get_bool (obj, "onChange", false);
-  result->interval = get_string  (obj, "interval");
+  iot_data_string_map_get_number (obj, "onChangeThreshold", IOT_DATA_FLOAT64, &result->onChangeThreshold);
+  iot_data_string_map_get_number (obj, "onChangePercent", IOT_DATA_FLOAT64, &result->onChangePercent);
+  iot_data_string_map_get_number (obj, "onChangeHysteresis", IOT_DATA_FLOAT64, &result->onChangeHysteresis);
+  result->interval = get_name (obj, "interval");
+  result->interval_ns = IOT_MS_TO_NS (edgex_parsetime (result->interval));
   return result;
 }
 
@@ -81,10 +94,11 @@ static edgex_device_autoevents *edgex_autoevents_read (const iot_data_t *obj)
 edgex_device *edgex_device_read (const iot_data_t *obj)
 {
   edgex_device *result = calloc (1, sizeof (edgex_device));
-  result->name = get_string (obj, "name");
+  result->name = get_name (obj, "name");
   result->profile = calloc (1, sizeof (edgex_deviceprofile));
-  result->profile->name = get_string (obj, "profileName");
-  result->servicename = get_string (obj, "serviceName");
+  atomic_store (&result->profile->refs, 1);
+  result->profile->name = get_name (obj, "profileName");
+  result->servicename = get_name (obj, "serviceName");
   result->protocols = edgex_protocols_read (iot_data_string_map_get (obj, "protocols"));
   result->adminState = edgex_adminstate_read (iot_data_string_map_get (obj, "adminState"));
   result->description = get_string (obj, "description");
@@ -228,7 +242,7 @@ static edgex_propertyvalue *propertyvalue_read (const iot_data_t *obj)
 static edgex_deviceresource *deviceresource_read (const iot_data_t *obj)
 {
   edgex_deviceresource *result = malloc (sizeof (edgex_deviceresource));
-  result->name = get_string (obj, "name");
+  result->name = get_name (obj, "name");
   result->description = get_string (obj, "description");
   result->tag = get_string (obj, "tag");
   result->properties = propertyvalue_read (iot_data_string_map_get (obj, "properties"));
@@ -254,7 +268,7 @@ static edgex_devicecommand *devicecommand_read (const iot_data_t *obj)
   edgex_devicecommand *result = calloc (1, sizeof (edgex_devicecommand));
   edgex_resourceoperation **last_ptr = &result->resourceOperations;
 
-  result->name = get_string (obj, "name");
+  result->name = get_name (obj, "name");
   edgex_get_readwrite (obj, &result->readable, &result->writable);
   ops = iot_data_string_map_get (obj, "resourceOperations");
   iot_data_vector_iter (ops, &iter);
@@ -271,12 +285,13 @@ static edgex_devicecommand *devicecommand_read (const iot_data_t *obj)
 edgex_deviceprofile *edgex_profile_read (const iot_data_t *obj)
 {
   edgex_deviceprofile *result = calloc (1, sizeof (edgex_deviceprofile));
+  atomic_store (&result->refs, 1);
   edgex_deviceresource **last_ptr = &result->device_resources;
   edgex_devicecommand **last_ptr2 = &result->device_commands;
   const iot_data_t *vec;
   iot_data_vector_iter_t iter;
 
-  result->name = get_string (obj, "name");
+  result->name = get_name (obj, "name");
   result->description = get_string (obj, "description");
   result->manufacturer = get_string (obj, "manufacturer");
   result->model = get_string (obj, "model");
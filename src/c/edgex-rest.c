@@ -13,6 +13,7 @@
 #include "autoevent.h"
 #include "watchers.h"
 #include "correlation.h"
+#include "intern.h"
 #include "parson.h"
 #include <microhttpd.h>
 #include <string.h>
@@ -34,6 +35,12 @@ static char *get_string (const JSON_Object *obj, const char *name)
   return get_string_dfl (obj, name, "");
 }
 
+static char *get_name (const JSON_Object *obj, const char *name)
+{
+  const char *str = json_object_get_string (obj, name);
+  return edgex_intern (str ? str : "");
+}
+
 static const char *get_array_string (const JSON_Array *array, size_t index)
 {
   const char *str = json_array_get_string (array, index);
@@ -284,7 +291,7 @@ static edgex_deviceresource *edgex_deviceresource_dup (const edgex_deviceresourc
   while (e)
   {
     edgex_deviceresource *elem = malloc (sizeof (edgex_deviceresource));
-    elem->name = strdup (e->name);
+    elem->name = edgex_intern_dup (e->name);
     elem->description = strdup (e->description);
     elem->tag = strdup (e->tag);
     elem->properties = propertyvalue_dup (e->properties);
@@ -303,7 +310,7 @@ static void deviceresource_free (devsdk_service_t *svc, edgex_deviceresource *e)
   while (e)
   {
     edgex_deviceresource *current = e;
-    free (e->name);
+    edgex_intern_release (e->name);
     free (e->description);
     free (e->tag);
     propertyvalue_free (e->properties);
@@ -355,7 +362,7 @@ static edgex_devicecommand *devicecommand_dup (const edgex_devicecommand *pr)
   while (pr)
   {
     edgex_devicecommand *elem = malloc (sizeof (edgex_devicecommand));
-    elem->name = strdup (pr->name);
+    elem->name = edgex_intern_dup (pr->name);
     elem->readable = pr->readable;
     elem->writable = pr->writable;
     elem->resourceOperations = resourceoperation_dup (pr->resourceOperations);
@@ -372,7 +379,7 @@ static void devicecommand_free (edgex_devicecommand *e)
   while (e)
   {
     edgex_devicecommand *current = e;
-    free (e->name);
+    edgex_intern_release (e->name);
     resourceoperation_free (e->resourceOperations);
     e = e->next;
     free (current);
@@ -381,28 +388,38 @@ static void devicecommand_free (edgex_devicecommand *e)
 
 static void cmdinfo_free (edgex_cmdinfo *inf)
 {
-  while (inf)
+  /* All cmdinfo for a profile share the allocation headed by the first */
+  for (edgex_cmdinfo *i = inf; i; i = i->next)
   {
-    edgex_cmdinfo *next = inf->next;
-    for (unsigned i = 0; i < inf->nreqs; i++)
+    for (unsigned n = 0; n < i->nreqs; n++)
     {
-      free (inf->reqs[i].resource);
+      iot_data_free (i->maps[n]);
     }
-    free (inf->reqs);
-    free (inf->pvals);
-    free (inf->maps);
-    free (inf->dfls);
-    free (inf);
-    inf = next;
+  }
+  free (inf);
+}
+
+void edgex_cmdindex_free (edgex_cmdindex *idx)
+{
+  if (idx)
+  {
+    edgex_map_deinit (&idx->getcmds);
+    edgex_map_deinit (&idx->setcmds);
+    edgex_map_deinit (&idx->resources);
+    free (idx);
   }
 }
 
 static edgex_device_autoevents *autoevent_read (const JSON_Object *obj)
 {
   edgex_device_autoevents *result = malloc (sizeof (edgex_device_autoevents));
-  result->resource = get_string (obj, "sourceName");
+  result->resource = get_name (obj, "sourceName");
   result->onChange = get_boolean (obj, "onChange", false);
-  result->interval = get_string  (obj, "interval");
+  result->onChangeThreshold = json_object_get_number (obj, "onChangeThreshold");
+  result->onChangePercent = json_object_get_number (obj, "onChangePercent");
+  result->onChangeHysteresis = json_object_get_number (obj, "onChangeHysteresis");
+  result->interval = get_name (obj, "interval");
+  result->interval_ns = IOT_MS_TO_NS (edgex_parsetime (result->interval));
   result->impl = NULL;
   result->next = NULL;
   return result;
@@ -420,6 +437,18 @@ static JSON_Value *autoevents_write (const edgex_device_autoevents *e)
     json_object_set_string (pobj, "sourceName", ae->resource);
     json_object_set_string (pobj, "interval", ae->interval);
     json_object_set_boolean (pobj, "onChange", ae->onChange);
+    if (ae->onChangeThreshold)
+    {
+      json_object_set_number (pobj, "onChangeThreshold", ae->onChangeThreshold);
+    }
+    if (ae->onChangePercent)
+    {
+      json_object_set_number (pobj, "onChangePercent", ae->onChangePercent);
+    }
+    if (ae->onChangeHysteresis)
+    {
+      json_object_set_number (pobj, "onChangeHysteresis", ae->onChangeHysteresis);
+    }
     json_array_append_value (arr, pval);
   }
   return result;
@@ -433,9 +462,13 @@ static edgex_device_autoevents *autoevents_dup
   while (e)
   {
     edgex_device_autoevents *elem = malloc (sizeof (edgex_device_autoevents));
-    elem->resource = strdup (e->resource);
-    elem->interval = strdup (e->interval);
+    elem->resource = edgex_intern_dup (e->resource);
+    elem->interval = edgex_intern_dup (e->interval);
+    elem->interval_ns = e->interval_ns;
     elem->onChange = e->onChange;
+    elem->onChangeThreshold = e->onChangeThreshold;
+    elem->onChangePercent = e->onChangePercent;
+    elem->onChangeHysteresis = e->onChangeHysteresis;
     elem->impl = NULL;
     elem->next = NULL;
     *current = elem;
@@ -450,8 +483,8 @@ void edgex_device_autoevents_free (edgex_device_autoevents *e)
   while (e)
   {
     edgex_device_autoevents *next = e->next;
-    free (e->resource);
-    free (e->interval);
+    edgex_intern_release (e->resource);
+    edgex_intern_release (e->interval);
     free (e);
     e = next;
   }
@@ -465,7 +498,7 @@ static devsdk_protocols *protocols_read (const JSON_Object *obj)
   {
     JSON_Value *pval = json_object_get_value_at (obj, i);
     devsdk_protocols *prot = malloc (sizeof (devsdk_protocols));
-    prot->name = strdup (json_object_get_name (obj, i));
+    prot->name = edgex_intern (json_object_get_name (obj, i));
     prot->properties = string_map_read (pval);
     prot->next = result;
     result = prot;
@@ -491,8 +524,8 @@ devsdk_protocols *devsdk_protocols_dup (const devsdk_protocols *e)
   for (const devsdk_protocols *p = e; p; p = p->next)
   {
     devsdk_protocols *newprot = malloc (sizeof (devsdk_protocols));
-    newprot->name = strdup (p->name);
-    newprot->properties = iot_data_copy (p->properties);
+    newprot->name = edgex_intern_dup (p->name);
+    newprot->properties = iot_data_add_ref (p->properties);
     newprot->next = result;
     result = newprot;
   }
@@ -504,7 +537,7 @@ void devsdk_protocols_free (devsdk_protocols *e)
   while (e)
   {
     devsdk_protocols *next = e->next;
-    free (e->name);
+    edgex_intern_release (e->name);
     iot_data_free (e->properties);
     free (e);
     e = next;
@@ -560,7 +593,8 @@ edgex_deviceprofile *edgex_deviceprofile_dup (const edgex_deviceprofile *src)
   if (src)
   {
     dest = calloc (1, sizeof (edgex_deviceprofile));
-    dest->name = strdup (src->name);
+    atomic_store (&dest->refs, 1);
+    dest->name = edgex_intern_dup (src->name);
     dest->description = SAFE_STRDUP (src->description);
     dest->manufacturer = SAFE_STRDUP (src->manufacturer);
     dest->model = SAFE_STRDUP (src->model);
@@ -576,7 +610,7 @@ void edgex_deviceprofile_free (devsdk_service_t *svc, edgex_deviceprofile *e)
   while (e)
   {
     edgex_deviceprofile *next = e->next;
-    free (e->name);
+    edgex_intern_release (e->name);
     free (e->description);
     free (e->manufacturer);
     free (e->model);
@@ -584,11 +618,25 @@ void edgex_deviceprofile_free (devsdk_service_t *svc, edgex_deviceprofile *e)
     deviceresource_free (svc, e->device_resources);
     devicecommand_free (e->device_commands);
     cmdinfo_free (e->cmdinfo);
+    edgex_cmdindex_free (e->cmdindex);
     free (e);
     e = next;
   }
 }
 
+void edgex_deviceprofile_addref (edgex_deviceprofile *e)
+{
+  atomic_fetch_add (&e->refs, 1);
+}
+
+void edgex_deviceprofile_release (devsdk_service_t *svc, edgex_deviceprofile *e)
+{
+  if (atomic_fetch_sub (&e->refs, 1) == 1)
+  {
+    edgex_deviceprofile_free (svc, e);
+  }
+}
+
 edgex_deviceservice *edgex_deviceservice_read (const char *json)
 {
   edgex_deviceservice *result = NULL;
@@ -675,18 +723,15 @@ char *edgex_updateDSreq_write (const char *name, const char *baseaddr)
 static edgex_device *device_read (const JSON_Object *obj)
 {
   edgex_device *result = malloc (sizeof (edgex_device));
-  result->name = get_string (obj, "name");
-  result->parent = get_string (obj, "parent");
+  result->name = get_name (obj, "name");
   // If the parent is empty, set it to NULL, helps avoid breakage if core-metadata support
   // for the field is not yet in place
-  if (result->parent && *result->parent == '\0')
-  {
-    free (result->parent);
-    result->parent = NULL;
-  }  
+  const char *parent = json_object_get_string (obj, "parent");
+  result->parent = (parent && *parent) ? edgex_intern (parent) : NULL;
   result->profile = calloc (1, sizeof (edgex_deviceprofile));
-  result->profile->name = get_string (obj, "profileName");
-  result->servicename = get_string (obj, "serviceName");
+  atomic_store (&result->profile->refs, 1);
+  result->profile->name = get_name (obj, "profileName");
+  result->servicename = get_name (obj, "serviceName");
   result->protocols = protocols_read
     (json_object_get_object (obj, "protocols"));
   result->adminState = edgex_adminstate_fromstring
@@ -740,8 +785,8 @@ static JSON_Value *device_write (const edgex_device *e)
 edgex_device *edgex_device_dup (const edgex_device *e)
 {
   edgex_device *result = malloc (sizeof (edgex_device));
-  result->name = strdup (e->name);
-result->parent = e->parent ? strdup(e->parent) : NULL;
+  result->name = edgex_intern_dup (e->name);
+  result->parent = edgex_intern_dup (e->parent);
   result->description = strdup (e->description);
   result->labels = devsdk_strings_dup (e->labels);
   result->protocols = devsdk_protocols_dup (e->protocols);
@@ -749,7 +794,7 @@ result->parent = e->parent ? strdup(e->parent) : NULL;
   result->adminState = e->adminState;
   result->operatingState = e->operatingState;
   result->origin = e->origin;
-  result->servicename = strdup (e->servicename);
+  result->servicename = edgex_intern_dup (e->servicename);
   result->profile = edgex_deviceprofile_dup (e->profile);
   result->devimpl = malloc (sizeof (devsdk_device_t));
   result->devimpl->name = result->name;
@@ -789,7 +834,7 @@ devsdk_devices *edgex_device_todevsdk (devsdk_service_t *svc, const edgex_device
   iot_data_t *exc = NULL;
   devsdk_devices *result = malloc (sizeof (devsdk_devices));
   result->device = malloc (sizeof (devsdk_device_t));
-  result->device->name = strdup (e->name);
+  result->device->name = edgex_intern_dup (e->name);
   result->device->address = svc->userfns.create_addr (svc->userdata, e->protocols, &exc);
   result->resources = edgex_profile_toresources (e->profile);
   result->next = NULL;
@@ -806,21 +851,18 @@ void edgex_device_free (devsdk_service_t *svc, edgex_device *e)
     edgex_device_autoevents_free (e->autos);
     free (e->description);
     devsdk_strings_free (e->labels);
-    free (e->name);
+    edgex_intern_release (e->name);
     if (e->profile)
     {
-      edgex_deviceprofile_free (svc, e->profile);
+      edgex_deviceprofile_release (svc, e->profile);
     }
-    free (e->servicename);
+    edgex_intern_release (e->servicename);
     if (e->devimpl->address)
     {
       svc->userfns.free_addr (svc->userdata, e->devimpl->address);
     }
     free (e->devimpl);
-    if (e->parent)
-    {
-      free (e->parent);
-    }
+    edgex_intern_release (e->parent);
     e = e->next;
     free (current);
   }
@@ -882,16 +924,20 @@ char *edgex_updateDevOpreq_write (const char *name, edgex_device_operatingstate
   return json;
 }
 
-char *edgex_updateDevLCreq_write (const char *name, uint64_t lastconnected)
+char *edgex_updateDevLCreq_write (unsigned n, const char **names, const uint64_t *lastconnected)
 {
   char *json;
-  JSON_Value *val;
-  JSON_Value *jval = json_value_init_object ();
-  JSON_Object *obj = json_value_get_object (jval);
+  JSON_Value *val = json_value_init_array ();
+  JSON_Array *array = json_value_get_array (val);
 
-  json_object_set_string (obj, "name", name);
-  json_object_set_uint (obj, "lastConnected", lastconnected);
-  val = edgex_wrap_request ("Device", jval);
+  for (unsigned i = 0; i < n; i++)
+  {
+    JSON_Value *jval = json_value_init_object ();
+    JSON_Object *obj = json_value_get_object (jval);
+    json_object_set_string (obj, "name", names[i]);
+    json_object_set_uint (obj, "lastConnected", lastconnected[i]);
+    json_array_append_value (array, edgex_wrap_request_single ("Device", jval));
+  }
   json = json_serialize_to_string (val);
   json_value_free (val);
 
@@ -27,6 +27,11 @@ void devsdk_protocols_free (devsdk_protocols *e);
 devsdk_device_resources *edgex_profile_toresources (const edgex_deviceprofile *p);
 edgex_deviceprofile *edgex_deviceprofile_dup (const edgex_deviceprofile *e);
 void edgex_deviceprofile_free (devsdk_service_t *svc, edgex_deviceprofile *e);
+
+/* Profiles are reference counted, so that work started against a profile held in the device map
+   can finish after the profile has been replaced. A new profile has a single reference */
+void edgex_deviceprofile_addref (edgex_deviceprofile *e);
+void edgex_deviceprofile_release (devsdk_service_t *svc, edgex_deviceprofile *e);
 edgex_deviceservice *edgex_deviceservice_read (const char *json);
 void edgex_deviceservice_free (edgex_deviceservice *e);
 void edgex_device_autoevents_free (edgex_device_autoevents *e);
@@ -62,7 +67,7 @@ edgex_deviceservice *edgex_getDSresponse_read (const char *json);
 
 char *edgex_createdevicereq_write (const edgex_device *dev);
 char *edgex_updateDevOpreq_write (const char *name, edgex_device_operatingstate opstate);
-char *edgex_updateDevLCreq_write (const char *name, uint64_t lastconnected);
+char *edgex_updateDevLCreq_write (unsigned n, const char **names, const uint64_t *lastconnected);
 
 
 #endif
@@ -0,0 +1,354 @@
+/* Pseudo-device service demonstrating the asynchronous driver API */
+
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include <unistd.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include "devsdk/devsdk.h"
+
+#define NCOUNTERS 64
+#define MAX_EVENTS 32
+
+#define ERR_CHECK(x) if (x.code) { fprintf (stderr, "Error: %d: %s\n", x.code, x.reason); devsdk_service_free (service); free (impl); return x.code; }
+
+/* Each device is a counter which answers after a delay, as a device on a slow link would. Rather than
+ * blocking in the handlers, requests are parked on a timer in an epoll loop run by the driver's own
+ * thread, and completed from there. A single thread thus serves any number of outstanding requests.
+ */
+
+typedef struct async_addr
+{
+  unsigned index;
+  unsigned delay;                  // milliseconds
+} async_addr;
+
+typedef struct async_op
+{
+  int fd;
+  unsigned index;
+  devsdk_commandresult *readings;  // NULL for a write
+  uint32_t value;
+  devsdk_async_t *handle;
+} async_op;
+
+typedef struct async_driver
+{
+  iot_logger_t * lc;
+  atomic_uint_fast32_t counters[NCOUNTERS];
+  int epfd;
+  int stopfd;
+  pthread_t thread;
+  atomic_bool stopping;
+  atomic_uint pending;
+} async_driver;
+
+static void *async_loop (void *p)
+{
+  async_driver *driver = (async_driver *) p;
+  struct epoll_event events[MAX_EVENTS];
+
+  while (true)
+  {
+    int n = epoll_wait (driver->epfd, events, MAX_EVENTS, -1);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    for (int i = 0; i < n; i++)
+    {
+      async_op *op = (async_op *) events[i].data.ptr;
+      if (op == NULL)
+      {
+        uint64_t count;
+        if (read (driver->stopfd, &count, sizeof (count)) < 0)
+        {
+          iot_log_warn (driver->lc, "Read from stop event failed: %s", strerror (errno));
+        }
+        atomic_store (&driver->stopping, true);
+        continue;
+      }
+      epoll_ctl (driver->epfd, EPOLL_CTL_DEL, op->fd, NULL);
+      close (op->fd);
+      if (op->readings)
+      {
+        op->readings[0].value = iot_data_alloc_ui32 (atomic_fetch_add (&driver->counters[op->index], 1));
+      }
+      else
+      {
+        atomic_store (&driver->counters[op->index], op->value);
+      }
+      devsdk_async_complete (op->handle, true, NULL);
+      free (op);
+      atomic_fetch_sub (&driver->pending, 1);
+    }
+    /* On stop, keep going until the requests already parked have been completed */
+    if (atomic_load (&driver->stopping) && atomic_load (&driver->pending) == 0)
+    {
+      return NULL;
+    }
+  }
+}
+
+static bool async_init
+  (void *impl, struct iot_logger_t *lc, const iot_data_t *config)
+{
+  async_driver *driver = (async_driver *) impl;
+  driver->lc = lc;
+  for (unsigned i = 0; i < NCOUNTERS; i++)
+  {
+    atomic_store (&driver->counters[i], 0);
+  }
+  atomic_store (&driver->stopping, false);
+  atomic_store (&driver->pending, 0);
+  driver->epfd = epoll_create1 (EPOLL_CLOEXEC);
+  driver->stopfd = eventfd (0, EFD_CLOEXEC);
+  if (driver->epfd < 0 || driver->stopfd < 0)
+  {
+    iot_log_error (lc, "Unable to create epoll instance: %s", strerror (errno));
+    return false;
+  }
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+  epoll_ctl (driver->epfd, EPOLL_CTL_ADD, driver->stopfd, &ev);
+  pthread_create (&driver->thread, NULL, async_loop, driver);
+  return true;
+}
+
+/* Park a request on a one-shot timer. The epoll loop completes it when the timer fires */
+
+static bool async_submit (async_driver *driver, const async_addr *addr, async_op *op, iot_data_t **exception)
+{
+  struct itimerspec its = { .it_value = { .tv_sec = addr->delay / 1000, .tv_nsec = (addr->delay % 1000) * 1000000 + 1 } };
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = op };
+
+  if (atomic_load (&driver->stopping))
+  {
+    *exception = iot_data_alloc_string ("Driver is stopping", IOT_DATA_REF);
+    free (op);
+    return false;
+  }
+  op->index = addr->index;
+  atomic_fetch_add (&driver->pending, 1);
+  op->fd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (op->fd < 0 || timerfd_settime (op->fd, 0, &its, NULL) < 0 || epoll_ctl (driver->epfd, EPOLL_CTL_ADD, op->fd, &ev) < 0)
+  {
+    *exception = iot_data_alloc_string (strerror (errno), IOT_DATA_COPY);
+    if (op->fd >= 0)
+    {
+      close (op->fd);
+    }
+    free (op);
+    atomic_fetch_sub (&driver->pending, 1);
+    return false;
+  }
+  return true;
+}
+
+static bool async_get_async
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nreadings,
+  const devsdk_commandrequest *requests,
+  devsdk_commandresult *readings,
+  const iot_data_t *options,
+  devsdk_async_t *handle,
+  iot_data_t **exception
+)
+{
+  async_op *op = calloc (1, sizeof (async_op));
+  op->readings = readings;
+  op->handle = handle;
+  return async_submit ((async_driver *) impl, (const async_addr *) device->address, op, exception);
+}
+
+static bool async_put_async
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nvalues,
+  const devsdk_commandrequest *requests,
+  const iot_data_t *values[],
+  const iot_data_t *options,
+  devsdk_async_t *handle,
+  iot_data_t **exception
+)
+{
+  async_op *op = calloc (1, sizeof (async_op));
+  op->value = iot_data_ui32 (values[0]);
+  op->handle = handle;
+  return async_submit ((async_driver *) impl, (const async_addr *) device->address, op, exception);
+}
+
+/* The blocking handlers are still required, but are not used once the asynchronous ones are set */
+
+static bool async_get_handler
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nreadings,
+  const devsdk_commandrequest *requests,
+  devsdk_commandresult *readings,
+  const iot_data_t *options,
+  iot_data_t **exception
+)
+{
+  async_driver *driver = (async_driver *) impl;
+  const async_addr *addr = (const async_addr *) device->address;
+  readings[0].value = iot_data_alloc_ui32 (atomic_fetch_add (&driver->counters[addr->index], 1));
+  return true;
+}
+
+static bool async_put_handler
+(
+  void *impl,
+  const devsdk_device_t *device,
+  uint32_t nvalues,
+  const devsdk_commandrequest *requests,
+  const iot_data_t *values[],
+  const iot_data_t *options,
+  iot_data_t **exception
+)
+{
+  async_driver *driver = (async_driver *) impl;
+  const async_addr *addr = (const async_addr *) device->address;
+  atomic_store (&driver->counters[addr->index], iot_data_ui32 (values[0]));
+  return true;
+}
+
+static devsdk_address_t async_create_addr (void *impl, const devsdk_protocols *protocols, iot_data_t **exception)
+{
+  const iot_data_t *props = devsdk_protocols_properties (protocols, "Delayed");
+  if (props == NULL)
+  {
+    *exception = iot_data_alloc_string ("No Delayed protocol in device address", IOT_DATA_REF);
+    return NULL;
+  }
+  const char *index = iot_data_string_map_get_string (props, "Index");
+  const char *delay = iot_data_string_map_get_string (props, "Delay");
+  if (index == NULL || delay == NULL)
+  {
+    *exception = iot_data_alloc_string ("Index or Delay in device address missing", IOT_DATA_REF);
+    return NULL;
+  }
+  char *end = NULL;
+  errno = 0;
+  unsigned long i = strtoul (index, &end, 0);
+  if (errno || *end || i >= NCOUNTERS)
+  {
+    *exception = iot_data_alloc_string ("Index in device address out of range", IOT_DATA_REF);
+    return NULL;
+  }
+  unsigned long d = strtoul (delay, &end, 0);
+  if (errno || *end)
+  {
+    *exception = iot_data_alloc_string ("Delay in device address is invalid", IOT_DATA_REF);
+    return NULL;
+  }
+  async_addr *result = malloc (sizeof (async_addr));
+  result->index = i;
+  result->delay = d;
+  return result;
+}
+
+static void async_free_addr (void *impl, devsdk_address_t address)
+{
+  free (address);
+}
+
+static devsdk_resource_attr_t async_create_resource_attr (void *impl, const iot_data_t *attributes, iot_data_t **exception)
+{
+  return malloc (1);
+}
+
+static void async_free_resource_attr (void *impl, devsdk_resource_attr_t resource)
+{
+  free (resource);
+}
+
+/* ---- Stop ---- */
+/* Stop the epoll loop, once the requests parked on it have been completed */
+static void async_stop (void *impl, bool force)
+{
+  async_driver *driver = (async_driver *) impl;
+  uint64_t one = 1;
+  if (write (driver->stopfd, &one, sizeof (one)) == sizeof (one))
+  {
+    pthread_join (driver->thread, NULL);
+  }
+  close (driver->stopfd);
+  close (driver->epfd);
+}
+
+int main (int argc, char *argv[])
+{
+  sigset_t set;
+  int sigret;
+
+  async_driver * impl = malloc (sizeof (async_driver));
+  impl->lc = NULL;
+
+  devsdk_error e;
+  e.code = 0;
+
+  devsdk_callbacks *asyncImpls = devsdk_callbacks_init
+  (
+    async_init,
+    async_get_handler,
+    async_put_handler,
+    async_stop,
+    async_create_addr,
+    async_free_addr,
+    async_create_resource_attr,
+    async_free_resource_attr
+  );
+  devsdk_callbacks_set_async_handlers (asyncImpls, async_get_async, async_put_async);
+
+  devsdk_service_t *service = devsdk_service_new
+    ("device-async", "1.0", impl, asyncImpls, &argc, argv, &e);
+  ERR_CHECK (e);
+
+  int n = 1;
+  while (n < argc)
+  {
+    if (strcmp (argv[n], "-h") == 0 || strcmp (argv[n], "--help") == 0)
+    {
+      printf ("Options:\n");
+      printf ("  -h, --help\t\t\tShow this text\n");
+      return 0;
+    }
+    else
+    {
+      printf ("%s: Unrecognized option %s\n", argv[0], argv[n]);
+      return 0;
+    }
+  }
+
+  devsdk_service_start (service, NULL, &e);
+  ERR_CHECK (e);
+
+  sigemptyset (&set);
+  sigaddset (&set, SIGINT);
+  sigprocmask (SIG_BLOCK, &set, NULL);
+  sigwait (&set, &sigret);
+  sigprocmask (SIG_UNBLOCK, &set, NULL);
+
+  devsdk_service_stop (service, true, &e);
+  ERR_CHECK (e);
+
+  devsdk_service_free (service);
+  free (impl);
+  free (asyncImpls);
+  return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define EDGEX_INTERN_MINBUCKETS 256
+
+typedef struct edgex_intern_entry
+{
+  struct edgex_intern_entry *next;
+  unsigned hash;
+  uint32_t refs;
+  size_t len;
+  char str[];
+} edgex_intern_entry;
+
+static struct
+{
+  pthread_mutex_t lock;
+  edgex_intern_entry **buckets;
+  unsigned nbuckets;
+  size_t strings;
+  size_t refs;
+  size_t bytes;
+  size_t saved;
+} intern_table = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static unsigned intern_hash (const char *str, size_t *len)
+{
+  const char *s = str;
+  unsigned hash = 5381;
+  while (*s)
+  {
+    hash = ((hash << 5) + hash) ^ (unsigned char)*s++;
+  }
+  *len = s - str;
+  return hash;
+}
+
+static edgex_intern_entry *intern_entry (const char *str)
+{
+  return (edgex_intern_entry *)(str - offsetof (edgex_intern_entry, str));
+}
+
+static void intern_resize (unsigned nbuckets)
+{
+  edgex_intern_entry **buckets = calloc (nbuckets, sizeof (edgex_intern_entry *));
+  for (unsigned i = 0; i < intern_table.nbuckets; i++)
+  {
+    edgex_intern_entry *e = intern_table.buckets[i];
+    while (e)
+    {
+      edgex_intern_entry *next = e->next;
+      unsigned idx = e->hash & (nbuckets - 1);
+      e->next = buckets[idx];
+      buckets[idx] = e;
+      e = next;
+    }
+  }
+  free (intern_table.buckets);
+  intern_table.buckets = buckets;
+  intern_table.nbuckets = nbuckets;
+}
+
+char *edgex_intern (const char *str)
+{
+  size_t len;
+  unsigned hash;
+  edgex_intern_entry *e;
+
+  if (str == NULL)
+  {
+    return NULL;
+  }
+  hash = intern_hash (str, &len);
+
+  pthread_mutex_lock (&intern_table.lock);
+  if (intern_table.nbuckets == 0)
+  {
+    intern_resize (EDGEX_INTERN_MINBUCKETS);
+  }
+  for (e = intern_table.buckets[hash & (intern_table.nbuckets - 1)]; e; e = e->next)
+  {
+    if (e->hash == hash && e->len == len && memcmp (e->str, str, len) == 0)
+    {
+      e->refs++;
+      intern_table.refs++;
+      intern_table.saved += len + 1;
+      break;
+    }
+  }
+  if (e == NULL)
+  {
+    if (intern_table.strings >= intern_table.nbuckets)
+    {
+      intern_resize (intern_table.nbuckets * 2);
+    }
+    e = malloc (sizeof (edgex_intern_entry) + len + 1);
+    memcpy (e->str, str, len + 1);
+    e->hash = hash;
+    e->len = len;
+    e->refs = 1;
+    unsigned idx = hash & (intern_table.nbuckets - 1);
+    e->next = intern_table.buckets[idx];
+    intern_table.buckets[idx] = e;
+    intern_table.strings++;
+    intern_table.refs++;
+    intern_table.bytes += len + 1;
+  }
+  pthread_mutex_unlock (&intern_table.lock);
+  return e->str;
+}
+
+char *edgex_intern_dup (const char *str)
+{
+  if (str == NULL)
+  {
+    return NULL;
+  }
+  edgex_intern_entry *e = intern_entry (str);
+  pthread_mutex_lock (&intern_table.lock);
+  e->refs++;
+  intern_table.refs++;
+  intern_table.saved += e->len + 1;
+  pthread_mutex_unlock (&intern_table.lock);
+  return e->str;
+}
+
+void edgex_intern_release (const char *str)
+{
+  if (str == NULL)
+  {
+    return;
+  }
+  edgex_intern_entry *e = intern_entry (str);
+  pthread_mutex_lock (&intern_table.lock);
+  intern_table.refs--;
+  if (--e->refs)
+  {
+    intern_table.saved -= e->len + 1;
+    e = NULL;
+  }
+  else
+  {
+    edgex_intern_entry **pe = &intern_table.buckets[e->hash & (intern_table.nbuckets - 1)];
+    while (*pe != e)
+    {
+      pe = &(*pe)->next;
+    }
+    *pe = e->next;
+    intern_table.strings--;
+    intern_table.bytes -= e->len + 1;
+  }
+  pthread_mutex_unlock (&intern_table.lock);
+  free (e);
+}
+
+void edgex_intern_getstats (edgex_intern_stats *stats)
+{
+  pthread_mutex_lock (&intern_table.lock);
+  stats->strings = intern_table.strings;
+  stats->refs = intern_table.refs;
+  stats->bytes = intern_table.bytes;
+  stats->saved = intern_table.saved;
+  pthread_mutex_unlock (&intern_table.lock);
+}
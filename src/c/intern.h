@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef _EDGEX_DEVICE_INTERN_H_
+#define _EDGEX_DEVICE_INTERN_H_ 1
+
+#include <stddef.h>
+
+/* Process-wide table of shared, reference-counted name strings. Device, profile,
+ * resource, command and protocol names are interned when they are read so that
+ * every copy of a given name refers to the same storage. Two interned strings are
+ * equal if and only if their pointers are equal.
+ *
+ * Interned strings must not be modified, and must be released with
+ * edgex_intern_release rather than free.
+ */
+
+typedef struct edgex_intern_stats
+{
+  size_t strings;      /* Number of distinct strings held */
+  size_t refs;         /* Total references to those strings */
+  size_t bytes;        /* Bytes of string data held */
+  size_t saved;        /* Bytes that separate copies of each reference would have needed */
+} edgex_intern_stats;
+
+/* Return the shared copy of str, taking a reference on it. NULL maps to NULL. */
+
+extern char *edgex_intern (const char *str);
+
+/* Take an additional reference on a string previously returned by edgex_intern. */
+
+extern char *edgex_intern_dup (const char *str);
+
+/* Drop a reference taken by edgex_intern or edgex_intern_dup. NULL is ignored. */
+
+extern void edgex_intern_release (const char *str);
+
+extern void edgex_intern_getstats (edgex_intern_stats *stats);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include "jwtcache.h"
+#include "iot/base64.h"
+#include "iot/data.h"
+#include "iot/time.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/* The table is set-associative: a token may be held in any of JWTCACHE_WAYS consecutive slots
+   starting at its hash. When these are all in use the entry closest to expiry is replaced */
+
+#define JWTCACHE_WAYS 4
+
+typedef struct jwtcache_slot
+{
+  uint64_t hash;
+  uint64_t expiry;
+  char *token;
+} jwtcache_slot;
+
+struct edgex_jwtcache_t
+{
+  jwtcache_slot *slots;
+  uint32_t mask;
+  uint64_t recheck;
+  devsdk_metrics_t *metrics;
+  pthread_mutex_t mtx;
+};
+
+static uint64_t jwtcache_hash (const char *s)
+{
+  uint64_t h = 14695981039346656037ULL;
+  while (*s)
+  {
+    h ^= (uint8_t)*s++;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/* The claims are held in the second, base64url-encoded, section of the token */
+
+uint64_t edgex_jwt_expiry (const char *jwt)
+{
+  uint64_t result = 0;
+  const char *start = strchr (jwt, '.');
+  const char *end = start ? strchr (start + 1, '.') : NULL;
+  if (end == NULL || end == start + 1)
+  {
+    return 0;
+  }
+  start++;
+  size_t len = end - start;
+  char *b64 = malloc (len + 4);
+  size_t i;
+  for (i = 0; i < len; i++)
+  {
+    b64[i] = (start[i] == '-') ? '+' : (start[i] == '_') ? '/' : start[i];
+  }
+  while (i % 4)
+  {
+    b64[i++] = '=';
+  }
+  b64[i] = '\0';
+
+  size_t sz = iot_b64_maxdecodesize (b64);
+  char *json = malloc (sz + 1);
+  if (iot_b64_decode (b64, json, &sz))
+  {
+    json[sz] = '\0';
+    iot_data_t *claims = iot_data_from_json (json);
+    if (claims && iot_data_type (claims) == IOT_DATA_MAP)
+    {
+      const iot_data_t *exp = iot_data_string_map_get (claims, "exp");
+      int64_t val;
+      if (exp && iot_data_cast (exp, IOT_DATA_INT64, &val) && val > 0)
+      {
+        result = val;
+      }
+    }
+    iot_data_free (claims);
+  }
+  free (json);
+  free (b64);
+  return result;
+}
+
+edgex_jwtcache_t *edgex_jwtcache_alloc (uint32_t size, uint32_t recheck, devsdk_metrics_t *metrics)
+{
+  edgex_jwtcache_t *cache = NULL;
+  if (size && recheck)
+  {
+    uint32_t n = JWTCACHE_WAYS;
+    while (n < size && n < 0x80000000u)
+    {
+      n <<= 1;
+    }
+    cache = calloc (1, sizeof (edgex_jwtcache_t));
+    cache->slots = calloc (n, sizeof (jwtcache_slot));
+    cache->mask = n - 1;
+    cache->recheck = recheck;
+    cache->metrics = metrics;
+    pthread_mutex_init (&cache->mtx, NULL);
+  }
+  return cache;
+}
+
+bool edgex_jwtcache_check (edgex_jwtcache_t *cache, const char *jwt)
+{
+  bool result = false;
+  if (cache)
+  {
+    uint64_t hash = jwtcache_hash (jwt);
+    uint64_t now = iot_time_secs ();
+    char *stale = NULL;
+
+    pthread_mutex_lock (&cache->mtx);
+    for (unsigned i = 0; i < JWTCACHE_WAYS; i++)
+    {
+      jwtcache_slot *s = &cache->slots[(hash + i) & cache->mask];
+      if (s->token && s->hash == hash && strcmp (s->token, jwt) == 0)
+      {
+        if (s->expiry > now)
+        {
+          result = true;
+        }
+        else
+        {
+          stale = s->token;
+          s->token = NULL;
+        }
+        break;
+      }
+    }
+    pthread_mutex_unlock (&cache->mtx);
+
+    free (stale);
+    atomic_fetch_add (result ? &cache->metrics->jwthit : &cache->metrics->jwtmiss, 1);
+  }
+  return result;
+}
+
+void edgex_jwtcache_add (edgex_jwtcache_t *cache, const char *jwt)
+{
+  if (cache == NULL)
+  {
+    return;
+  }
+  uint64_t now = iot_time_secs ();
+  uint64_t expiry = edgex_jwt_expiry (jwt);
+  if (expiry <= now)
+  {
+    return;
+  }
+  if (expiry > now + cache->recheck)
+  {
+    expiry = now + cache->recheck;
+  }
+
+  uint64_t hash = jwtcache_hash (jwt);
+  char *token = strdup (jwt);
+  char *old;
+  jwtcache_slot *victim = NULL;
+
+  pthread_mutex_lock (&cache->mtx);
+  for (unsigned i = 0; i < JWTCACHE_WAYS; i++)
+  {
+    jwtcache_slot *s = &cache->slots[(hash + i) & cache->mask];
+    if (s->token && s->hash == hash && strcmp (s->token, jwt) == 0)
+    {
+      victim = s;
+      break;
+    }
+    if (victim == NULL || (victim->token && (s->token == NULL || s->expiry < victim->expiry)))
+    {
+      victim = s;
+    }
+  }
+  old = victim->token;
+  victim->token = token;
+  victim->hash = hash;
+  victim->expiry = expiry;
+  pthread_mutex_unlock (&cache->mtx);
+
+  free (old);
+}
+
+void edgex_jwtcache_free (edgex_jwtcache_t *cache)
+{
+  if (cache)
+  {
+    for (uint32_t i = 0; i <= cache->mask; i++)
+    {
+      free (cache->slots[i].token);
+    }
+    free (cache->slots);
+    pthread_mutex_destroy (&cache->mtx);
+    free (cache);
+  }
+}
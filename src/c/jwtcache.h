@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef _EDGEX_JWTCACHE_H_
+#define _EDGEX_JWTCACHE_H_ 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "metrics.h"
+
+/* Cache of recently validated JWTs. Entries are held until the token's "exp" time or until
+ * recheck seconds have passed, whichever is sooner, so that revoked tokens are caught within
+ * the recheck interval. Tokens without a readable expiry are never cached.
+ */
+
+typedef struct edgex_jwtcache_t edgex_jwtcache_t;
+
+/* A size of zero disables caching */
+edgex_jwtcache_t *edgex_jwtcache_alloc (uint32_t size, uint32_t recheck, devsdk_metrics_t *metrics);
+
+/* Returns true if the token is cached and still within its validity period */
+bool edgex_jwtcache_check (edgex_jwtcache_t *cache, const char *jwt);
+
+/* Record that the token has just been validated */
+void edgex_jwtcache_add (edgex_jwtcache_t *cache, const char *jwt);
+
+void edgex_jwtcache_free (edgex_jwtcache_t *cache);
+
+/* Read the "exp" claim of a JWT, in seconds since the epoch. Returns zero if the token is malformed or has no expiry */
+uint64_t edgex_jwt_expiry (const char *jwt);
+
+#endif
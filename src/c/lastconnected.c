@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#include "lastconnected.h"
+#include "metadata.h"
+#include "correlation.h"
+#include "errorlist.h"
+#include "iot/time.h"
+
+/* Most devices updated by a single request to core-metadata */
+
+#define LC_BATCHMAX 100
+
+/* Shortest permitted flush interval, milliseconds */
+
+#define LC_MININTERVAL 10
+
+struct edgex_lcwriter
+{
+  devsdk_service_t *svc;
+  _Atomic (edgex_device *) pending;  // devices with an unsent update, each holding a reference
+  iot_schedule_t *schedule;
+  pthread_mutex_t flushmtx;
+  atomic_uint_fast64_t flushes;
+  atomic_uint_fast64_t updates;
+  atomic_uint_fast64_t latency;
+  atomic_uint_fast64_t maxlatency;
+  atomic_uint_fast64_t maxbatch;
+};
+
+static void lcwriter_max (atomic_uint_fast64_t *max, uint64_t val)
+{
+  uint64_t cur = atomic_load (max);
+  while (val > cur && !atomic_compare_exchange_weak (max, &cur, val));
+}
+
+static void lcwriter_send (edgex_lcwriter *w, unsigned n, edgex_device **devs, const uint64_t *times)
+{
+  const char *names[LC_BATCHMAX];
+  devsdk_error err = EDGEX_OK;
+
+  for (unsigned i = 0; i < n; i++)
+  {
+    names[i] = devs[i]->name;
+  }
+  edgex_metadata_client_update_lastconnected (w->svc->logger, &w->svc->config.endpoints, w->svc->secretstore, n, names, times, &err);
+  if (err.code)
+  {
+    iot_log_warn (w->svc->logger, "Unable to update lastConnected for %u device(s)", n);
+  }
+  for (unsigned i = 0; i < n; i++)
+  {
+    edgex_device_release (w->svc, devs[i]);
+  }
+}
+
+/* Send all pending updates. Unless wait is set, this returns immediately if another flush is
+   in progress, leaving the updates for the next one; so updates for a device are never sent
+   out of order */
+
+static void lcwriter_flush (edgex_lcwriter *w, bool wait)
+{
+  edgex_device *devs[LC_BATCHMAX];
+  uint64_t times[LC_BATCHMAX];
+  unsigned n = 0;
+  uint64_t total = 0;
+
+  if (wait)
+  {
+    pthread_mutex_lock (&w->flushmtx);
+  }
+  else if (pthread_mutex_trylock (&w->flushmtx) != 0)
+  {
+    return;
+  }
+
+  edgex_device *list = atomic_exchange (&w->pending, NULL);
+  if (list)
+  {
+    uint64_t start = iot_time_nsecs ();
+    edgex_device_alloc_crlid (NULL);
+    while (list)
+    {
+      edgex_device *dev = list;
+      list = dev->lcnext;
+      times[n] = atomic_exchange (&dev->lastconnected, 0);
+      devs[n++] = dev;
+      if (n == LC_BATCHMAX || list == NULL)
+      {
+        lcwriter_send (w, n, devs, times);
+        total += n;
+        n = 0;
+      }
+    }
+    edgex_device_free_crlid ();
+
+    uint64_t elapsed = iot_time_nsecs () - start;
+    atomic_fetch_add (&w->flushes, 1);
+    atomic_fetch_add (&w->updates, total);
+    atomic_fetch_add (&w->latency, elapsed);
+    lcwriter_max (&w->maxlatency, elapsed);
+    lcwriter_max (&w->maxbatch, total);
+  }
+  pthread_mutex_unlock (&w->flushmtx);
+}
+
+static void *lcwriter_run (void *p)
+{
+  lcwriter_flush ((edgex_lcwriter *)p, false);
+  return NULL;
+}
+
+edgex_lcwriter *edgex_lcwriter_alloc (devsdk_service_t *svc)
+{
+  edgex_lcwriter *w = calloc (1, sizeof (edgex_lcwriter));
+  w->svc = svc;
+  atomic_store (&w->pending, NULL);
+  pthread_mutex_init (&w->flushmtx, NULL);
+  return w;
+}
+
+void edgex_lcwriter_start (edgex_lcwriter *w)
+{
+  uint64_t interval = w->svc->config.device.lcinterval;
+  if (interval < LC_MININTERVAL)
+  {
+    interval = LC_MININTERVAL;
+  }
+  w->schedule = iot_schedule_create (w->svc->scheduler, lcwriter_run, NULL, w, IOT_MS_TO_NS (interval), 0, 0, w->svc->thpool, -1);
+  iot_schedule_add (w->svc->scheduler, w->schedule);
+}
+
+void edgex_lcwriter_stop (edgex_lcwriter *w)
+{
+  if (w->schedule)
+  {
+    iot_schedule_delete (w->svc->scheduler, w->schedule);
+    w->schedule = NULL;
+  }
+  lcwriter_flush (w, true);
+}
+
+void edgex_lcwriter_free (edgex_lcwriter *w)
+{
+  if (w)
+  {
+    edgex_device *list = atomic_exchange (&w->pending, NULL);
+    while (list)
+    {
+      edgex_device *dev = list;
+      list = dev->lcnext;
+      edgex_device_release (w->svc, dev);
+    }
+    pthread_mutex_destroy (&w->flushmtx);
+    free (w);
+  }
+}
+
+void edgex_lcwriter_note (edgex_lcwriter *w, edgex_device *dev)
+{
+  if (atomic_exchange (&dev->lastconnected, iot_time_msecs ()) == 0)
+  {
+    atomic_fetch_add (&dev->refs, 1);
+    edgex_device *head = atomic_load (&w->pending);
+    do
+    {
+      dev->lcnext = head;
+    } while (!atomic_compare_exchange_weak (&w->pending, &head, dev));
+  }
+}
+
+void edgex_lcwriter_note_name (edgex_lcwriter *w, const char *devname)
+{
+  edgex_device *dev = edgex_devmap_device_byname (w->svc->devices, devname);
+  if (dev)
+  {
+    edgex_lcwriter_note (w, dev);
+    edgex_device_release (w->svc, dev);
+  }
+}
+
+void edgex_lcwriter_getstats (edgex_lcwriter *w, edgex_lcwriter_stats *stats)
+{
+  stats->flushes = atomic_load (&w->flushes);
+  stats->updates = atomic_load (&w->updates);
+  stats->latency = atomic_load (&w->latency);
+  stats->maxlatency = atomic_exchange (&w->maxlatency, 0);
+  stats->maxbatch = atomic_exchange (&w->maxbatch, 0);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+#ifndef _EDGEX_DEVICE_LASTCONNECTED_H
+#define _EDGEX_DEVICE_LASTCONNECTED_H 1
+
+#include "service.h"
+
+/* Background writer for device lastConnected times. Recording an access only stores a
+ * timestamp in the device and, if none was pending, links the device onto a lock-free list.
+ * The list is flushed to core-metadata periodically, with one update per device however many
+ * times it was accessed since the previous flush.
+ */
+
+edgex_lcwriter *edgex_lcwriter_alloc (devsdk_service_t *svc);
+
+void edgex_lcwriter_start (edgex_lcwriter *w);
+
+/* Cancels the periodic flush and sends any updates still pending */
+
+void edgex_lcwriter_stop (edgex_lcwriter *w);
+
+void edgex_lcwriter_free (edgex_lcwriter *w);
+
+void edgex_lcwriter_note (edgex_lcwriter *w, edgex_device *dev);
+
+void edgex_lcwriter_note_name (edgex_lcwriter *w, const char *devname);
+
+typedef struct edgex_lcwriter_stats
+{
+  uint64_t flushes;                // flushes which sent at least one update
+  uint64_t updates;                // device updates sent
+  uint64_t latency;                // total time spent flushing, nanoseconds
+  uint64_t maxlatency;             // longest flush since the last call, nanoseconds
+  unsigned maxbatch;               // most updates in one flush since the last call
+} edgex_lcwriter_stats;
+
+void edgex_lcwriter_getstats (edgex_lcwriter *w, edgex_lcwriter_stats *stats);
+
+#endif
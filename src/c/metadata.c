@@ -137,7 +137,9 @@ void edgex_metadata_client_update_lastconnected
   iot_logger_t * lc,
   edgex_service_endpoints * endpoints,
   edgex_secret_provider_t * secretprovider,
-  const char * devicename,
+  unsigned ndevices,
+  const char ** devicenames,
+  const uint64_t * lastconnected,
   devsdk_error * err
 )
 {
@@ -145,9 +147,9 @@ void edgex_metadata_client_update_lastconnected
   char url[URL_BUF_SIZE];
 
   memset (&ctx, 0, sizeof (edgex_ctx));
-  char *json = edgex_updateDevLCreq_write (devicename, iot_time_msecs ());
+  char *json = edgex_updateDevLCreq_write (ndevices, devicenames, lastconnected);
 
-  snprintf (url, URL_BUF_SIZE - 1, "http://%s:%u/api/" EDGEX_API_VERSION" /device", endpoints->metadata.host, endpoints->metadata.port);
+  snprintf (url, URL_BUF_SIZE - 1, "http://%s:%u/api/" EDGEX_API_VERSION "/device", endpoints->metadata.host, endpoints->metadata.port);
 
   iot_data_t *jwt_data = edgex_secrets_request_jwt (secretprovider);  
   ctx.jwt_token = iot_data_string(jwt_data);
@@ -404,6 +406,7 @@ char *edgex_metadata_client_add_device
   dev->servicename = (char *)service_name;
   dev->profile = malloc (sizeof (edgex_deviceprofile));
   memset (dev->profile, 0, sizeof (edgex_deviceprofile));
+  atomic_store (&dev->profile->refs, 1);
   dev->profile->name = (char *)profile_name;
   dev->autos = autos;
   json = edgex_createdevicereq_write (dev);
@@ -537,6 +540,7 @@ void edgex_metadata_client_add_or_modify_device
   dev->autos = autos;
   dev->servicename = (char *)service_name;
   dev->profile = calloc (1, sizeof (edgex_deviceprofile));
+  atomic_store (&dev->profile->refs, 1);
   dev->profile->name = (char *)profile_name;
 
   json = edgex_createdevicereq_write (dev);
@@ -18,6 +18,12 @@ typedef struct devsdk_metrics_t
   atomic_uint_fast64_t rcexe;
   atomic_uint_fast64_t secrq;
   atomic_uint_fast64_t secsto;
+  atomic_uint_fast64_t aeskip;
+  atomic_uint_fast64_t aeoverrun;
+  atomic_uint_fast64_t jwthit;
+  atomic_uint_fast64_t jwtmiss;
+  atomic_uint_fast64_t jwtrefresh;
+  atomic_uint_fast64_t jwtfail;
 } devsdk_metrics_t;
 
 #endif
@@ -11,8 +11,55 @@
 #include "service.h"
 #include "errorlist.h"
 #include "cmdinfo.h"
+#include "async.h"
+#include "correlation.h"
+#include "map.h"
+#include "edgex-rest.h"
 
 #include <iot/thread.h>
+#include <iot/time.h>
+
+/* Operating state changes made by the SDK itself are queued and sent to core-metadata by a
+ * worker on the thread pool. Only the latest requested state of each device is kept, and a
+ * request for the state that was last sent, or is being sent, is dropped for OPSTATE_HOLDOFF
+ * seconds while the change makes its way back to us in a device update callback. Failed
+ * updates are retried with the delay doubling from OPSTATE_RETRY_MIN up to OPSTATE_RETRY_MAX.
+ */
+
+#define OPSTATE_HOLDOFF 5
+#define OPSTATE_RETRY_MIN 1
+#define OPSTATE_RETRY_MAX 60
+
+typedef struct opstate_entry
+{
+  edgex_device_operatingstate want;   // state to send if queued
+  edgex_device_operatingstate sent;   // last state sent successfully, if sentat is nonzero
+  uint64_t sentat;                    // when sent was sent, seconds
+  uint64_t retryat;                   // earliest time to send want, seconds
+  unsigned failures;
+  bool queued;
+  bool sending;
+} opstate_entry;
+
+typedef edgex_map(opstate_entry) edgex_map_opstate;
+
+struct edgex_opqueue
+{
+  devsdk_service_t *svc;
+  pthread_mutex_t mtx;
+  edgex_map_opstate devices;
+  bool running;                       // worker queued or running
+  uint64_t retryat;                   // time of the earliest scheduled retry, zero if none
+};
+
+typedef struct opqueue_retry_param
+{
+  edgex_opqueue *q;
+  uint64_t at;
+  iot_schedule_t *self;
+} opqueue_retry_param;
+
+static void *opqueue_run (void *p);
 
 typedef struct devsdk_devret_param_t
 {
@@ -39,6 +86,266 @@ void devsdk_set_device_opstate (devsdk_service_t *svc, const char *devname, bool
   {
     iot_log_error (svc->logger, "Unable to change operational state for device %s", devname);
   }
+  else if (svc->opqueue)
+  {
+    edgex_opqueue *q = svc->opqueue;
+    pthread_mutex_lock (&q->mtx);
+    opstate_entry *e = edgex_map_get (&q->devices, devname);
+    if (e && !e->sending)
+    {
+      e->sent = operational ? UP : DOWN;
+      e->sentat = iot_time_secs ();
+      if (e->queued && e->want == e->sent)
+      {
+        e->queued = false;
+      }
+    }
+    pthread_mutex_unlock (&q->mtx);
+  }
+}
+
+static bool opqueue_redundant (const opstate_entry *e, edgex_device_operatingstate state, uint64_t now)
+{
+  return (e->sending || (e->sentat && now < e->sentat + OPSTATE_HOLDOFF)) && e->sent == state;
+}
+
+edgex_opqueue *edgex_opqueue_alloc (devsdk_service_t *svc)
+{
+  edgex_opqueue *q = calloc (1, sizeof (edgex_opqueue));
+  q->svc = svc;
+  pthread_mutex_init (&q->mtx, NULL);
+  edgex_map_init (&q->devices);
+  return q;
+}
+
+void edgex_opqueue_stop (edgex_opqueue *q)
+{
+  const char *key;
+  bool start = false;
+
+  pthread_mutex_lock (&q->mtx);
+  edgex_map_iter i = edgex_map_iter (q->devices);
+  while ((key = edgex_map_next (&q->devices, &i)))
+  {
+    opstate_entry *e = edgex_map_get (&q->devices, key);
+    if (e->queued)
+    {
+      e->retryat = 0;
+    }
+  }
+  if (!q->running)
+  {
+    q->running = true;
+    start = true;
+  }
+  pthread_mutex_unlock (&q->mtx);
+
+  if (start)
+  {
+    opqueue_run (q);
+  }
+}
+
+void edgex_opqueue_free (edgex_opqueue *q)
+{
+  if (q)
+  {
+    edgex_map_deinit (&q->devices);
+    pthread_mutex_destroy (&q->mtx);
+    free (q);
+  }
+}
+
+void devsdk_queue_device_opstate (devsdk_service_t *svc, const char *devname, bool operational)
+{
+  edgex_opqueue *q = svc->opqueue;
+  edgex_device_operatingstate state = operational ? UP : DOWN;
+  uint64_t now = iot_time_secs ();
+  bool start = false;
+
+  pthread_mutex_lock (&q->mtx);
+  opstate_entry *e = edgex_map_get (&q->devices, devname);
+  if (e == NULL)
+  {
+    opstate_entry init = { .want = state };
+    edgex_map_set (&q->devices, devname, init);
+    e = edgex_map_get (&q->devices, devname);
+  }
+  if (e->queued || !opqueue_redundant (e, state, now))
+  {
+    e->want = state;
+    if (!e->queued)
+    {
+      e->queued = true;
+      e->retryat = 0;
+      e->failures = 0;
+    }
+    if (!q->running)
+    {
+      q->running = true;
+      start = true;
+    }
+  }
+  pthread_mutex_unlock (&q->mtx);
+
+  if (start)
+  {
+    iot_threadpool_add_work (svc->thpool, opqueue_run, q, -1);
+  }
+}
+
+static void *opqueue_retry (void *p)
+{
+  opqueue_retry_param *param = (opqueue_retry_param *)p;
+  edgex_opqueue *q = param->q;
+  bool start = false;
+
+  pthread_mutex_lock (&q->mtx);
+  if (q->retryat == param->at)
+  {
+    q->retryat = 0;
+  }
+  if (!q->running)
+  {
+    q->running = true;
+    start = true;
+  }
+  pthread_mutex_unlock (&q->mtx);
+
+  if (start)
+  {
+    opqueue_run (q);
+  }
+  iot_schedule_delete (q->svc->scheduler, param->self);
+  return NULL;
+}
+
+/* Called with the lock held. Arrange for the worker to run again when the next retry falls due.
+   A retry already scheduled for later is left in place; the worker finds nothing due then */
+
+static void opqueue_schedule_retry (edgex_opqueue *q, uint64_t at, uint64_t now)
+{
+  if (q->retryat && q->retryat <= at)
+  {
+    return;
+  }
+  opqueue_retry_param *param = malloc (sizeof (opqueue_retry_param));
+  param->q = q;
+  param->at = at;
+  param->self = iot_schedule_create (q->svc->scheduler, opqueue_retry, free, param, 0, IOT_SEC_TO_NS (at - now), 1, q->svc->thpool, IOT_THREAD_NO_PRIORITY);
+  q->retryat = at;
+  iot_schedule_add (q->svc->scheduler, param->self);
+}
+
+static void *opqueue_run (void *p)
+{
+  edgex_opqueue *q = (edgex_opqueue *)p;
+  devsdk_service_t *svc = q->svc;
+
+  pthread_mutex_lock (&q->mtx);
+  while (true)
+  {
+    /* Collect the updates which are due */
+
+    uint64_t now = iot_time_secs ();
+    uint64_t nextretry = 0;
+    unsigned n = 0;
+    unsigned ndead = 0;
+    char **names = malloc (q->devices.base.nnodes * sizeof (char *));
+    edgex_device_operatingstate *states = malloc (q->devices.base.nnodes * sizeof (edgex_device_operatingstate));
+    char **dead = malloc (q->devices.base.nnodes * sizeof (char *));
+    const char *key;
+    edgex_map_iter i = edgex_map_iter (q->devices);
+
+    while ((key = edgex_map_next (&q->devices, &i)))
+    {
+      opstate_entry *e = edgex_map_get (&q->devices, key);
+      if (e->queued && opqueue_redundant (e, e->want, now))
+      {
+        e->queued = false;
+      }
+      if (e->queued && e->retryat <= now)
+      {
+        e->queued = false;
+        e->sending = true;
+        e->sent = e->want;
+        names[n] = strdup (key);
+        states[n++] = e->want;
+      }
+      else if (e->queued)
+      {
+        nextretry = (nextretry && nextretry < e->retryat) ? nextretry : e->retryat;
+      }
+      else if (!e->sending && now >= e->sentat + OPSTATE_HOLDOFF)
+      {
+        dead[ndead++] = strdup (key);
+      }
+    }
+    for (unsigned d = 0; d < ndead; d++)
+    {
+      edgex_map_remove (&q->devices, dead[d]);
+      free (dead[d]);
+    }
+    free (dead);
+
+    if (n == 0)
+    {
+      if (nextretry)
+      {
+        opqueue_schedule_retry (q, nextretry, now);
+      }
+      q->running = false;
+      free (names);
+      free (states);
+      break;
+    }
+
+    /* Send them without holding the lock, then record the outcomes */
+
+    pthread_mutex_unlock (&q->mtx);
+    bool *ok = malloc (n * sizeof (bool));
+    edgex_device_alloc_crlid (NULL);
+    for (unsigned j = 0; j < n; j++)
+    {
+      devsdk_error err = EDGEX_OK;
+      edgex_metadata_client_set_device_opstate (svc->logger, &svc->config.endpoints, svc->secretstore, names[j], states[j], &err);
+      ok[j] = (err.code == 0);
+    }
+    edgex_device_free_crlid ();
+    pthread_mutex_lock (&q->mtx);
+
+    now = iot_time_secs ();
+    for (unsigned j = 0; j < n; j++)
+    {
+      opstate_entry *e = edgex_map_get (&q->devices, names[j]);
+      e->sending = false;
+      if (ok[j])
+      {
+        e->sentat = now;
+        e->failures = 0;
+      }
+      else
+      {
+        e->sentat = 0;
+        if (!e->queued)
+        {
+          unsigned shift = e->failures < 6 ? e->failures : 6;
+          uint64_t delay = OPSTATE_RETRY_MIN << shift;
+          e->queued = true;
+          e->want = states[j];
+          e->failures++;
+          e->retryat = now + (delay < OPSTATE_RETRY_MAX ? delay : OPSTATE_RETRY_MAX);
+          iot_log_error (svc->logger, "Unable to change operational state for device %s, will retry in %" PRIu64 "s", names[j], e->retryat - now);
+        }
+      }
+      free (names[j]);
+    }
+    free (ok);
+    free (names);
+    free (states);
+  }
+  pthread_mutex_unlock (&q->mtx);
+  return NULL;
 }
 
 static void devsdk_devret_param_free (void *p)
@@ -72,7 +379,8 @@ static void *devsdk_device_return (void *p)
     }
     else
     {
-      edgex_cmdinfo *cmd = dev->profile->cmdinfo;
+      edgex_deviceprofile *profile = edgex_devmap_device_profile (param->svc->devices, dev);
+      edgex_cmdinfo *cmd = profile->cmdinfo;
       while (cmd && !cmd->isget && cmd->nreqs > 1)
       {
         cmd = cmd->next;
@@ -81,11 +389,10 @@ static void *devsdk_device_return (void *p)
       {
         iot_data_t *e = NULL;
         devsdk_commandresult result = { 0 };
-        if (param->svc->userfns.gethandler (param->svc->userdata, dev->devimpl, 1, cmd->reqs, &result, NULL, &e))
+        if (edgex_device_get (param->svc, dev, profile, 1, cmd->reqs, &result, NULL, &e))
         {
-          devsdk_error err;
           iot_log_debug (param->svc->logger, "Device %s responsive: setting operational state to up", name);
-          devsdk_set_device_opstate (param->svc, name, true, &err);
+          devsdk_queue_device_opstate (param->svc, name, true);
         }
         else
         {
@@ -98,6 +405,7 @@ static void *devsdk_device_return (void *p)
       {
         iot_log_error (param->svc->logger, "Device %s has no readable resources, cannot be set operational automatically", name);
       }
+      edgex_deviceprofile_release (param->svc, profile);
     }
     edgex_device_release (param->svc, dev);
   }
@@ -113,9 +421,8 @@ void devsdk_device_request_failed (devsdk_service_t *svc, edgex_device *dev)
 {
   if (svc->config.device.allowed_fails && --dev->retries == 0)
   {
-    devsdk_error err;
     iot_log_warn (svc->logger, "Marking device %s non-operational", dev->name);
-    devsdk_set_device_opstate (svc, dev->name, false, &err);
+    devsdk_queue_device_opstate (svc, dev->name, false);
     if (svc->config.device.dev_downtime)
     {
       uint64_t wait = IOT_SEC_TO_NS (svc->config.device.dev_downtime);
@@ -132,8 +439,7 @@ void devsdk_device_request_succeeded (devsdk_service_t *svc, edgex_device *dev)
     dev->retries = svc->config.device.allowed_fails;
     if (dev->operatingState == DOWN)
     {
-      devsdk_error err;
-      devsdk_set_device_opstate (svc, dev->name, true, &err);
+      devsdk_queue_device_opstate (svc, dev->name, true);
     }
   }
 }
@@ -11,6 +11,21 @@
 
 #include "devsdk/devsdk.h"
 #include "edgex/edgex.h"
+#include "service.h"
+
+/* Queue of operating state changes to be sent to core-metadata in the background */
+
+edgex_opqueue *edgex_opqueue_alloc (devsdk_service_t *svc);
+
+/* Send any queued changes, including those awaiting a retry. Call once the thread pool is idle */
+
+void edgex_opqueue_stop (edgex_opqueue *q);
+
+void edgex_opqueue_free (edgex_opqueue *q);
+
+/* Request a change of operating state without waiting for it to be sent. Repeated requests are collapsed */
+
+void devsdk_queue_device_opstate (devsdk_service_t *svc, const char *devname, bool operational);
 
 void devsdk_device_request_failed (devsdk_service_t *svc, edgex_device *dev);
 
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2026
+ * IoTech Ltd
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ */
+
+/* Posting of readings generated by the driver outside of GET requests */
+
+#include "service.h"
+#include "device.h"
+#include "devmap.h"
+#include "data.h"
+#include "metadata.h"
+#include "lastconnected.h"
+#include "correlation.h"
+#include "errorlist.h"
+#include "intern.h"
+#include "edgex-rest.h"
+
+struct devsdk_reading_handle_t
+{
+  devsdk_service_t *svc;
+  char *device;                    // interned
+  char *resource;                  // interned
+  uint64_t generation;             // devmap generation at which dev and cmd were resolved
+  const edgex_device *dev;
+  const edgex_cmdinfo *cmd;
+};
+
+static void readings_publish (devsdk_service_t *svc, const char *devname, edgex_event_cooked *event)
+{
+  edgex_device_alloc_crlid (NULL);
+  if (svc->config.device.maxeventsize && edgex_event_cooked_size (event) > svc->config.device.maxeventsize * 1024)
+  {
+    iot_log_error (svc->logger, "Post readings: Event size (%zu KiB) exceeds configured MaxEventSize", edgex_event_cooked_size (event) / 1024);
+  }
+  else
+  {
+    edgex_data_client_add_event (svc->msgbus, event, &svc->metrics);
+  }
+
+  if (svc->config.device.updatelastconnected)
+  {
+    edgex_lcwriter_note_name (svc->lcwriter, devname);
+  }
+  edgex_device_free_crlid();
+  edgex_event_cooked_free (event);
+}
+
+void devsdk_post_readings
+(
+  devsdk_service_t *svc,
+  const char *devname,
+  const char *resname,
+  devsdk_commandresult *values
+)
+{
+  if (svc->adminstate == LOCKED)
+  {
+    iot_log_debug (svc->logger, "Post readings: dropping event as service is locked");
+    return;
+  }
+
+  edgex_device *dev = edgex_devmap_device_byname (svc->devices, devname);
+  if (dev == NULL)
+  {
+    iot_log_error (svc->logger, "Post readings: no such device %s", devname);
+    return;
+  }
+
+  /* The event refers to strings held by the profile, so a reference on it is kept until the event is published */
+  edgex_event_cooked *event = NULL;
+  edgex_deviceprofile *profile = edgex_devmap_device_profile (svc->devices, dev);
+  const edgex_cmdinfo *command = edgex_deviceprofile_findcommand (svc, resname, profile, true);
+  if (command)
+  {
+    event = edgex_data_process_event (devname, command, values, svc->config.device.datatransform);
+  }
+  edgex_device_release (svc, dev);
+
+  if (command == NULL)
+  {
+    iot_log_error (svc->logger, "Post readings: no such resource %s", resname);
+  }
+  else if (event)
+  {
+    readings_publish (svc, devname, event);
+  }
+  edgex_deviceprofile_release (svc, profile);
+}
+
+uint32_t devsdk_post_readings_batch (devsdk_service_t *svc, uint32_t n, const devsdk_reading_batch *batch)
+{
+  uint32_t nevents = 0;
+
+  if (svc->adminstate == LOCKED)
+  {
+    iot_log_debug (svc->logger, "Post readings: dropping %u events as service is locked", (unsigned)n);
+    return 0;
+  }
+
+  /* Resolve and encode every entry under one acquisition of the read lock. Each event refers to strings held
+     by its profile, so a reference on the profile is kept until the events are published */
+  edgex_event_cooked **events = calloc (n, sizeof (edgex_event_cooked *));
+  edgex_deviceprofile **profiles = calloc (n, sizeof (edgex_deviceprofile *));
+  edgex_devmap_rdlock (svc->devices);
+  for (uint32_t i = 0; i < n; i++)
+  {
+    const edgex_device *dev = edgex_devmap_device_locked (svc->devices, batch[i].device_name);
+    const edgex_cmdinfo *command = dev ? edgex_deviceprofile_findcommand (svc, batch[i].resource_name, dev->profile, true) : NULL;
+    if (dev == NULL)
+    {
+      iot_log_error (svc->logger, "Post readings: no such device %s", batch[i].device_name);
+    }
+    else if (command == NULL)
+    {
+      iot_log_error (svc->logger, "Post readings: no such resource %s", batch[i].resource_name);
+    }
+    else
+    {
+      events[i] = edgex_data_process_event (batch[i].device_name, command, batch[i].values, svc->config.device.datatransform);
+      if (events[i])
+      {
+        profiles[i] = command->profile;
+        edgex_deviceprofile_addref (profiles[i]);
+      }
+    }
+  }
+  edgex_devmap_unlock (svc->devices);
+
+  if (svc->config.device.maxeventsize)
+  {
+    for (uint32_t i = 0; i < n; i++)
+    {
+      if (events[i] && edgex_event_cooked_size (events[i]) > svc->config.device.maxeventsize * 1024)
+      {
+        iot_log_error (svc->logger, "Post readings: Event size (%zu KiB) exceeds configured MaxEventSize", edgex_event_cooked_size (events[i]) / 1024);
+        edgex_event_cooked_free (events[i]);
+        events[i] = NULL;
+      }
+    }
+  }
+
+  edgex_device_alloc_crlid (NULL);
+  edgex_data_client_add_events (svc->msgbus, n, events, &svc->metrics);
+
+  for (uint32_t i = 0; i < n; i++)
+  {
+    if (events[i])
+    {
+      nevents++;
+      if (svc->config.device.updatelastconnected)
+      {
+        edgex_lcwriter_note_name (svc->lcwriter, batch[i].device_name);
+      }
+      edgex_event_cooked_free (events[i]);
+    }
+    if (profiles[i])
+    {
+      edgex_deviceprofile_release (svc, profiles[i]);
+    }
+  }
+  edgex_device_free_crlid ();
+  free (profiles);
+  free (events);
+  return nevents;
+}
+
+devsdk_reading_handle_t *devsdk_reading_handle_new (devsdk_service_t *svc, const char *device_name, const char *resource_name)
+{
+  devsdk_reading_handle_t *h = calloc (1, sizeof (devsdk_reading_handle_t));
+  h->svc = svc;
+  h->device = edgex_intern (device_name);
+  h->resource = edgex_intern (resource_name);
+  h->generation = UINT64_MAX;
+  return h;
+}
+
+/* Called with the devmap read lock held */
+
+static void reading_handle_resolve (devsdk_reading_handle_t *h, uint64_t generation)
+{
+  h->dev = edgex_devmap_device_locked (h->svc->devices, h->device);
+  h->cmd = h->dev ? edgex_deviceprofile_findcommand (h->svc, h->resource, h->dev->profile, true) : NULL;
+  if (h->dev == NULL)
+  {
+    iot_log_error (h->svc->logger, "Post readings: no such device %s", h->device);
+  }
+  else if (h->cmd == NULL)
+  {
+    iot_log_error (h->svc->logger, "Post readings: no such resource %s", h->resource);
+  }
+  h->generation = generation;
+}
+
+bool devsdk_reading_handle_post (devsdk_reading_handle_t *h, devsdk_commandresult *values)
+{
+  devsdk_service_t *svc = h->svc;
+  edgex_event_cooked *event = NULL;
+  edgex_deviceprofile *profile = NULL;
+
+  if (svc->adminstate == LOCKED)
+  {
+    iot_log_debug (svc->logger, "Post readings: dropping event as service is locked");
+    return false;
+  }
+
+  /* The generation cannot change while the read lock is held, so the cached device and command stay valid.
+     The event refers to strings held by the profile, so a reference on it is kept until the event is published */
+  edgex_devmap_rdlock (svc->devices);
+  uint64_t generation = edgex_devmap_generation (svc->devices);
+  if (h->generation != generation)
+  {
+    reading_handle_resolve (h, generation);
+  }
+  if (h->cmd)
+  {
+    event = edgex_data_process_event (h->device, h->cmd, values, svc->config.device.datatransform);
+    if (event)
+    {
+      profile = h->cmd->profile;
+      edgex_deviceprofile_addref (profile);
+    }
+  }
+  edgex_devmap_unlock (svc->devices);
+
+  if (event)
+  {
+    readings_publish (svc, h->device, event);
+    edgex_deviceprofile_release (svc, profile);
+  }
+  return event != NULL;
+}
+
+void devsdk_reading_handle_free (devsdk_reading_handle_t *h)
+{
+  if (h)
+  {
+    edgex_intern_release (h->device);
+    edgex_intern_release (h->resource);
+    free (h);
+  }
+}
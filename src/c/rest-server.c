@@ -11,16 +11,19 @@
 #include "edgex-rest.h"
 #include "correlation.h"
 #include "errorlist.h"
+#include "compress.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <microhttpd.h>
 
 #define EDGEX_ERRBUFSZ 1024
+#define HTTP_STREAM_BLOCKSIZE 65536
 
 #if MHD_VERSION > 0x00097001
 #define EDGEX_MHD_RESULT enum MHD_Result
@@ -28,15 +31,50 @@
 #define EDGEX_MHD_RESULT int
 #endif
 
+/* The last compressed body for a parameterless GET route, reused while the handler's output is unchanged.
+   The uncompressed body is kept to compare against. Each slot has its own lock */
+
+typedef struct http_precomp
+{
+  pthread_mutex_t mtx;
+  void *src;
+  size_t size;
+  void *data;
+  size_t zsize;
+} http_precomp;
+
 typedef struct handler_list
 {
   devsdk_strings *url;
   uint32_t methods;
   void *ctx;
   devsdk_http_handler_fn handler;
+  http_precomp precomp[2];           // indexed by coding - 1
   struct handler_list *next;
 } handler_list;
 
+/* Routes are compiled into a trie of path segments. Nodes are only ever added, and each is fully
+   initialised before being linked in with a release store, so requests match without taking a lock */
+
+typedef struct route_node
+{
+  char *seg;                              // literal segment, or parameter name for a parameter node
+  size_t len;
+  _Atomic (struct route_node *) literals; // first literal child
+  _Atomic (struct route_node *) params;   // first parameter child
+  struct route_node *next;                // next sibling, fixed before the node is published
+  _Atomic (handler_list *) handler;       // handler for a route ending at this node
+} route_node;
+
+#define ROUTE_MAXPARAMS 8
+
+typedef struct route_capture
+{
+  const route_node *node;
+  const char *value;
+  size_t len;
+} route_capture;
+
 typedef struct cors_config
 {
   const char *allowedorigin;
@@ -55,17 +93,106 @@ struct edgex_rest_server
   iot_logger_t *lc;
   struct MHD_Daemon *daemon;
   handler_list *handlers;
+  route_node routes;
   pthread_mutex_t lock;
   uint64_t maxsize;
+  size_t compressmin;
+  int compresslevel;
   cors_config cors;
+  struct http_context_s *ctxpool;
+  unsigned ctxpooled;
+  pthread_mutex_t poollock;
 };
 
+/* Request contexts and their body buffers are recycled. Buffers beyond HTTP_CTX_KEEPMAX are
+   not kept, so that one large upload does not pin its memory in the pool */
+
+#define HTTP_CTX_POOLMAX 32
+#define HTTP_CTX_KEEPMAX 65536
+
+/* An untrusted Content-Length is only believed up to this size when no MaxRequestSize is set */
+
+#define HTTP_CTX_PRESIZEMAX (16 * 1024 * 1024)
+
 typedef struct http_context_s
 {
   char *m_data;
   size_t m_size;
+  size_t m_cap;
+  struct http_context_s *next;
 } http_context_t;
 
+static http_context_t *http_context_get (edgex_rest_server *svr)
+{
+  pthread_mutex_lock (&svr->poollock);
+  http_context_t *ctx = svr->ctxpool;
+  if (ctx)
+  {
+    svr->ctxpool = ctx->next;
+    svr->ctxpooled--;
+  }
+  pthread_mutex_unlock (&svr->poollock);
+  if (ctx == NULL)
+  {
+    ctx = calloc (1, sizeof (http_context_t));
+  }
+  ctx->m_size = 0;
+  return ctx;
+}
+
+static void http_context_put (edgex_rest_server *svr, http_context_t *ctx)
+{
+  if (ctx->m_cap > HTTP_CTX_KEEPMAX)
+  {
+    free (ctx->m_data);
+    ctx->m_data = NULL;
+    ctx->m_cap = 0;
+  }
+  pthread_mutex_lock (&svr->poollock);
+  if (svr->ctxpooled < HTTP_CTX_POOLMAX)
+  {
+    ctx->next = svr->ctxpool;
+    svr->ctxpool = ctx;
+    svr->ctxpooled++;
+    ctx = NULL;
+  }
+  pthread_mutex_unlock (&svr->poollock);
+  if (ctx)
+  {
+    free (ctx->m_data);
+    free (ctx);
+  }
+}
+
+/* Grow geometrically when the body outruns its Content-Length (or there was none), within maxsize */
+
+static void http_context_reserve (edgex_rest_server *svr, http_context_t *ctx, size_t required)
+{
+  if (required > ctx->m_cap)
+  {
+    size_t cap = ctx->m_cap * 2;
+    if (cap < required)
+    {
+      cap = required;
+    }
+    if (svr->maxsize && cap > svr->maxsize)
+    {
+      cap = svr->maxsize;
+    }
+    ctx->m_data = realloc (ctx->m_data, cap);
+    ctx->m_cap = cap;
+  }
+}
+
+static void http_completed (void *cls, struct MHD_Connection *conn, void **context, enum MHD_RequestTerminationCode toe)
+{
+  if (*context)
+  {
+    http_context_put ((edgex_rest_server *)cls, (http_context_t *)*context);
+    *context = NULL;
+  }
+}
+
 static const char *ds_paramlist[] = DS_PARAMLIST;
 
 static devsdk_http_method method_from_string (const char *str)
@@ -105,6 +232,124 @@ static devsdk_strings *processUrl (const char *url)
   return result;
 }
 
+/* Locate the next segment of a path as processUrl does: leading slashes are skipped and a trailing
+   slash yields an empty final segment. *p is NULL once the path is exhausted */
+
+static bool url_next_segment (const char **p, const char **seg, size_t *len)
+{
+  if (*p == NULL)
+  {
+    return false;
+  }
+  const char *s = *p;
+  while (*s == '/') s++;
+  const char *e = strchr (s, '/');
+  *seg = s;
+  *len = e ? (size_t)(e - s) : strlen (s);
+  *p = e;
+  return true;
+}
+
+static route_node *route_child (route_node *parent, const char *seg, size_t len)
+{
+  bool param = (len >= 3 && seg[0] == '{' && seg[len - 1] == '}');
+  if (param)
+  {
+    seg++;
+    len -= 2;
+  }
+  _Atomic (route_node *) *list = param ? &parent->params : &parent->literals;
+  route_node *head = atomic_load_explicit (list, memory_order_acquire);
+  for (route_node *n = head; n; n = n->next)
+  {
+    if (n->len == len && strncmp (n->seg, seg, len) == 0)
+    {
+      return n;
+    }
+  }
+  route_node *n = calloc (1, sizeof (route_node));
+  n->seg = strndup (seg, len);
+  n->len = len;
+  n->next = head;
+  atomic_store_explicit (list, n, memory_order_release);
+  return n;
+}
+
+/* Literal children are preferred to parameters; on failure further down, matching backtracks */
+
+static handler_list *route_match (const route_node *node, const char *p, route_capture *caps, unsigned *ncaps)
+{
+  const char *seg;
+  size_t len;
+  if (!url_next_segment (&p, &seg, &len))
+  {
+    return atomic_load_explicit (&node->handler, memory_order_acquire);
+  }
+  for (const route_node *n = atomic_load_explicit (&node->literals, memory_order_acquire); n; n = n->next)
+  {
+    if (n->len == len && strncmp (n->seg, seg, len) == 0)
+    {
+      handler_list *h = route_match (n, p, caps, ncaps);
+      if (h)
+      {
+        return h;
+      }
+      break;
+    }
+  }
+  if (*ncaps < ROUTE_MAXPARAMS)
+  {
+    for (const route_node *n = atomic_load_explicit (&node->params, memory_order_acquire); n; n = n->next)
+    {
+      unsigned mark = *ncaps;
+      caps[(*ncaps)++] = (route_capture){ .node = n, .value = seg, .len = len };
+      handler_list *h = route_match (n, p, caps, ncaps);
+      if (h)
+      {
+        return h;
+      }
+      *ncaps = mark;
+    }
+  }
+  return NULL;
+}
+
+static devsdk_nvpairs *route_params (const route_capture *caps, unsigned ncaps)
+{
+  devsdk_nvpairs *result = NULL;
+  for (unsigned i = 0; i < ncaps; i++)
+  {
+    devsdk_nvpairs *nv = malloc (sizeof (devsdk_nvpairs));
+    nv->name = strdup (caps[i].node->seg);
+    nv->value = strndup (caps[i].value, caps[i].len);
+    nv->next = result;
+    result = nv;
+  }
+  return result;
+}
+
+static void route_free (route_node *node)
+{
+  route_node *n = atomic_load (&node->literals);
+  while (n)
+  {
+    route_node *next = n->next;
+    route_free (n);
+    free (n->seg);
+    free (n);
+    n = next;
+  }
+  n = atomic_load (&node->params);
+  while (n)
+  {
+    route_node *next = n->next;
+    route_free (n);
+    free (n->seg);
+    free (n);
+    n = next;
+  }
+}
+
 static EDGEX_MHD_RESULT queryIterator (void *p, enum MHD_ValueKind kind, const char *key, const char *value)
 {
   if (strncmp (key, DS_PREFIX, strlen (DS_PREFIX)) == 0)
@@ -129,32 +374,6 @@ static EDGEX_MHD_RESULT queryIterator (void *p, enum MHD_ValueKind kind, const c
   return MHD_YES;
 }
 
-static bool match_url_pattern (const devsdk_strings *pattern, const devsdk_strings *url, devsdk_nvpairs **params)
-{
-  bool result = true;
-  while (result && pattern && url)
-  {
-    if (strcmp (pattern->str, url->str))
-    {
-      size_t plen = strlen (pattern->str);
-      if (plen >= 3 && *pattern->str == '{' && *(pattern->str + plen - 1) == '}')
-      {
-        char *name = alloca (plen - 1);
-        strncpy (name, pattern->str + 1, plen - 2);
-        name[plen - 2] = '\0';
-        *params = devsdk_nvpairs_new (name, url->str, *params);
-      }
-      else
-      {
-        result = false;
-      }
-    }
-    pattern = pattern->next;
-    url = url->next;
-  }
-  return result && !(pattern || url);
-}
-
 static bool cors_string_in_list (const char *s, char ** l)
 {
   while (*l)
@@ -254,6 +473,46 @@ static void set_header_if_nonempty (struct MHD_Response *response, const char *h
   }
 }
 
+static void *http_compress (edgex_rest_server *svr, handler_list *cache, edgex_coding coding, const void *data, size_t size, size_t *zsize)
+{
+  void *result = NULL;
+  http_precomp *pc = cache ? &cache->precomp[coding - 1] : NULL;
+  if (pc)
+  {
+    pthread_mutex_lock (&pc->mtx);
+    if (pc->data && pc->size == size && memcmp (pc->src, data, size) == 0)
+    {
+      result = malloc (pc->zsize);
+      memcpy (result, pc->data, pc->zsize);
+      *zsize = pc->zsize;
+    }
+    pthread_mutex_unlock (&pc->mtx);
+    if (result)
+    {
+      return result;
+    }
+  }
+  result = edgex_compress (coding, svr->compresslevel, data, size, zsize);
+  if (result && pc)
+  {
+    void *src = malloc (size);
+    void *copy = malloc (*zsize);
+    memcpy (src, data, size);
+    memcpy (copy, result, *zsize);
+    pthread_mutex_lock (&pc->mtx);
+    void *oldsrc = pc->src;
+    void *olddata = pc->data;
+    pc->src = src;
+    pc->size = size;
+    pc->data = copy;
+    pc->zsize = *zsize;
+    pthread_mutex_unlock (&pc->mtx);
+    free (oldsrc);
+    free (olddata);
+  }
+  return result;
+}
+
 static EDGEX_MHD_RESULT http_handler
 (
   void *this,
@@ -273,16 +532,30 @@ static EDGEX_MHD_RESULT http_handler
   void *reply = NULL;
   size_t reply_size = 0;
   const char *reply_type = NULL;
+  devsdk_http_stream_fn stream = NULL;
+  void (*stream_free) (void *) = NULL;
+  void *stream_ctx = NULL;
   handler_list *h;
+  handler_list *cacheable = NULL;
+  edgex_coding coding = EDGEX_CODING_NONE;
   bool cors_passed = false;
 
   /* First call used to create call context */
 
   if (ctx == 0)
   {
-    ctx = (http_context_t *) malloc (sizeof (*ctx));
-    ctx->m_size = 0;
-    ctx->m_data = NULL;
+    const char *clen = MHD_lookup_connection_value (conn, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_LENGTH);
+    size_t expected = clen ? strtoull (clen, NULL, 10) : 0;
+    if (svr->maxsize && expected + 1 > svr->maxsize)
+    {
+      iot_log_error (svr->lc, "http: request size of %zu exceeds configured maximum", expected + 1);
+      return MHD_NO;
+    }
+    ctx = http_context_get (svr);
+    if (expected)
+    {
+      http_context_reserve (svr, ctx, (svr->maxsize || expected < HTTP_CTX_PRESIZEMAX) ? expected + 1 : HTTP_CTX_PRESIZEMAX);
+    }
     *context = (void *) ctx;
     return MHD_YES;
   }
@@ -294,12 +567,12 @@ static EDGEX_MHD_RESULT http_handler
     size_t required = ctx->m_size + (*upload_data_size) + 1;
     if (svr->maxsize && required > svr->maxsize)
     {
-      free (ctx->m_data);
-      free (ctx);
+      http_context_put (svr, ctx);
+      *context = NULL;
       iot_log_error (svr->lc, "http: request size of %zu exceeds configured maximum", required);
       return MHD_NO;
     }
-    ctx->m_data = (char *) realloc (ctx->m_data, required);
+    http_context_reserve (svr, ctx, required);
     memcpy (ctx->m_data + ctx->m_size, upload_data, (*upload_data_size));
     ctx->m_size += *upload_data_size;
     ctx->m_data[ctx->m_size] = 0;
@@ -326,8 +599,7 @@ static EDGEX_MHD_RESULT http_handler
       MHD_add_response_header (response, "Access-Control-Max-Age", svr->cors.maxage);
       MHD_queue_response (conn, MHD_HTTP_NO_CONTENT, response);
       MHD_destroy_response (response);
-      free (ctx->m_data);
-      free (ctx);
+      http_context_put (svr, ctx);
       edgex_device_free_crlid ();
       return MHD_YES;
     }
@@ -371,18 +643,15 @@ static EDGEX_MHD_RESULT http_handler
   else
   {
     devsdk_nvpairs *params = NULL;
-    devsdk_strings *elems = processUrl (url);
+    route_capture caps[ROUTE_MAXPARAMS];
+    unsigned ncaps = 0;
     status = MHD_HTTP_NOT_FOUND;
     iot_log_trace (svr->lc, "Incoming %s request to %s%s%s", methodname, url, ctx->m_size ? ", data " : " (no data)", ctx->m_size ? ctx->m_data : "");
-    pthread_mutex_lock (&svr->lock);
-    for (h = svr->handlers; h; h = h->next)
+    h = route_match (&svr->routes, url, caps, &ncaps);
+    if (h)
     {
-      if (match_url_pattern (h->url, elems, &params))
-      {
-        break;
-      }
+      params = route_params (caps, ncaps);
     }
-    pthread_mutex_unlock (&svr->lock);
     if (h)
     {
       if (method & h->methods)
@@ -399,7 +668,7 @@ static EDGEX_MHD_RESULT http_handler
           MHD_get_connection_values (conn, MHD_GET_ARGUMENT_KIND, queryIterator, req.qparams);
           req.params = params;
           req.method = method;
-          req.data.bytes = ctx->m_data;
+          req.data.bytes = ctx->m_size ? ctx->m_data : NULL;
           req.data.size = ctx->m_size;
           req.authorization_header_value = MHD_lookup_connection_value (conn, MHD_HEADER_KIND, MHD_HTTP_HEADER_AUTHORIZATION);
           req.content_type = MHD_lookup_connection_value (conn, MHD_HEADER_KIND, MHD_HTTP_HEADER_CONTENT_TYPE);
@@ -409,6 +678,10 @@ static EDGEX_MHD_RESULT http_handler
           reply = rep.data.bytes;
           reply_size = rep.data.size;
           reply_type = rep.content_type;
+          stream = rep.stream;
+          stream_free = rep.stream_free;
+          stream_ctx = rep.stream_ctx;
+          cacheable = (method == DevSDK_Get && ncaps == 0 && status == MHD_HTTP_OK) ? h : NULL;
           cors_passed = svr->cors.enabled;
           iot_data_free (req.qparams);
         }
@@ -419,7 +692,28 @@ static EDGEX_MHD_RESULT http_handler
       }
     }
     devsdk_nvpairs_free (params);
-    devsdk_strings_free (elems);
+  }
+
+  /* Compress if the client accepts it and the reply is large enough */
+
+  if (svr->compressmin && stream == NULL && reply && reply_size >= svr->compressmin)
+  {
+    coding = edgex_compress_negotiate (MHD_lookup_connection_value (conn, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING));
+    if (coding != EDGEX_CODING_NONE)
+    {
+      size_t zsize;
+      void *z = http_compress (svr, cacheable, coding, reply, reply_size, &zsize);
+      if (z)
+      {
+        free (reply);
+        reply = z;
+        reply_size = zsize;
+      }
+      else
+      {
+        coding = EDGEX_CODING_NONE;
+      }
+    }
   }
 
   /* Send reply */
@@ -428,14 +722,29 @@ static EDGEX_MHD_RESULT http_handler
   {
     reply_type = CONTENT_PLAINTEXT;
   }
-  if (reply == NULL)
+  if (stream)
+  {
+    response = MHD_create_response_from_callback (reply_size, HTTP_STREAM_BLOCKSIZE, stream, stream_ctx, stream_free);
+  }
+  else
   {
-    reply = strdup ("");
-    reply_size = 0;
+    if (reply == NULL)
+    {
+      reply = strdup ("");
+      reply_size = 0;
+    }
+    response = MHD_create_response_from_buffer (reply_size, reply, MHD_RESPMEM_MUST_FREE);
   }
-  response = MHD_create_response_from_buffer (reply_size, reply, MHD_RESPMEM_MUST_FREE);
   MHD_add_response_header (response, "Content-Type", reply_type);
   MHD_add_response_header (response, "X-Correlation-ID", edgex_device_get_crlid ());
+  if (coding != EDGEX_CODING_NONE)
+  {
+    MHD_add_response_header (response, MHD_HTTP_HEADER_CONTENT_ENCODING, edgex_compress_name (coding));
+  }
+  if (svr->compressmin)
+  {
+    MHD_add_response_header (response, MHD_HTTP_HEADER_VARY, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  }
   if (cors_passed)
   {
     set_header_if_nonempty (response, MHD_HTTP_HEADER_ACCESS_CONTROL_ALLOW_ORIGIN, svr->cors.allowedorigin);
@@ -448,8 +757,7 @@ static EDGEX_MHD_RESULT http_handler
 
   /* Clean up */
 
-  free (ctx->m_data);
-  free (ctx);
+  http_context_put (svr, ctx);
   edgex_device_free_crlid ();
   return MHD_YES;
 }
@@ -489,22 +797,51 @@ static void edgex_rest_server_log (void *ctx, const char * fmt, va_list ap)
 }
 
 edgex_rest_server *edgex_rest_server_create
-  (iot_logger_t *lc, const char *bindaddr, uint16_t port, uint64_t maxsize, devsdk_error *err)
+  (iot_logger_t *lc, const char *bindaddr, uint16_t port, const edgex_rest_server_options *opts, devsdk_error *err)
 {
   edgex_rest_server *svr;
-  uint16_t flags = MHD_USE_THREAD_PER_CONNECTION | MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG;
+  unsigned flags = MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_ERROR_LOG;
+  struct MHD_OptionItem mhdopts[7];
+  unsigned nopts = 0;
+  struct addrinfo *res = NULL;
 
   svr = calloc (1, sizeof (edgex_rest_server));
   svr->lc = lc;
-  svr->maxsize = maxsize;
+  svr->maxsize = opts->maxsize;
+  svr->compressmin = opts->compressmin;
+  svr->compresslevel = opts->compresslevel;
 
   pthread_mutex_init (&svr->lock, NULL);
+  pthread_mutex_init (&svr->poollock, NULL);
+
+  /* In pooled mode a fixed set of threads each poll (epoll where available) a share of the connections */
+
+  if (opts->pooled)
+  {
+    uint32_t threads = opts->threads ? opts->threads : 1;
+    flags |= MHD_USE_AUTO;
+    mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_THREAD_POOL_SIZE, threads, NULL };
+    iot_log_info (lc, "HTTP server using a pool of %" PRIu32 " threads", threads);
+  }
+  else
+  {
+    flags |= MHD_USE_THREAD_PER_CONNECTION;
+  }
+  if (opts->maxconns)
+  {
+    mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_CONNECTION_LIMIT, opts->maxconns, NULL };
+  }
+  if (opts->maxconnsperip)
+  {
+    mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_PER_IP_CONNECTION_LIMIT, opts->maxconnsperip, NULL };
+  }
+  mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_EXTERNAL_LOGGER, (intptr_t)edgex_rest_server_log, lc };
+  mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_NOTIFY_COMPLETED, (intptr_t)http_completed, svr };
 
   /* Start http server */
 
   if (strcmp (bindaddr, "0.0.0.0"))
   {
-    struct addrinfo *res;
     char svc[6];
     char resaddr[INET6_ADDRSTRLEN];
     sprintf (svc, "%" PRIu16, port);
@@ -517,18 +854,27 @@ edgex_rest_server *edgex_rest_server_create
       {
         flags |= MHD_USE_IPv6;
       }
-      svr->daemon = MHD_start_daemon (flags, port, 0, 0, http_handler, svr, MHD_OPTION_EXTERNAL_LOGGER, edgex_rest_server_log, lc, MHD_OPTION_SOCK_ADDR, res->ai_addr, MHD_OPTION_END);
-      freeaddrinfo (res);
+      mhdopts[nopts++] = (struct MHD_OptionItem){ MHD_OPTION_SOCK_ADDR, 0, res->ai_addr };
     }
     else
     {
       iot_log_error (lc, "HTTP server: unable to resolve bind address %s", bindaddr);
+      res = NULL;
     }
   }
   else
   {
     iot_log_info (lc, "Starting HTTP server on port %d (all interfaces)", port);
-    svr->daemon = MHD_start_daemon (flags, port, 0, 0, http_handler, svr, MHD_OPTION_EXTERNAL_LOGGER, edgex_rest_server_log, lc, MHD_OPTION_END);
+  }
+  mhdopts[nopts] = (struct MHD_OptionItem){ MHD_OPTION_END, 0, NULL };
+
+  if (res || strcmp (bindaddr, "0.0.0.0") == 0)
+  {
+    svr->daemon = MHD_start_daemon (flags, port, 0, 0, http_handler, svr, MHD_OPTION_ARRAY, mhdopts, MHD_OPTION_END);
+  }
+  if (res)
+  {
+    freeaddrinfo (res);
   }
 
   if (svr->daemon == NULL)
@@ -554,12 +900,14 @@ bool edgex_rest_server_register_handler
 )
 {
   bool result = true;
-  handler_list *entry = malloc (sizeof (handler_list));
+  handler_list *entry = calloc (1, sizeof (handler_list));
   entry->handler = handler;
   entry->url = processUrl (url);
   entry->methods = methods;
   entry->ctx = context;
   entry->next = NULL;
+  pthread_mutex_init (&entry->precomp[0].mtx, NULL);
+  pthread_mutex_init (&entry->precomp[1].mtx, NULL);
   pthread_mutex_lock (&svr->lock);
   handler_list **tail = &svr->handlers;
   while (*tail)
@@ -567,6 +915,18 @@ bool edgex_rest_server_register_handler
     tail = &((*tail)->next);
   }
   *tail = entry;
+
+  /* As with the handler list, the first registration of a route takes precedence */
+  route_node *node = &svr->routes;
+  const char *p = url;
+  const char *seg;
+  size_t len;
+  while (url_next_segment (&p, &seg, &len))
+  {
+    node = route_child (node, seg, len);
+  }
+  handler_list *expected = NULL;
+  atomic_compare_exchange_strong_explicit (&node->handler, &expected, entry, memory_order_release, memory_order_relaxed);
   pthread_mutex_unlock (&svr->lock);
   return result;
 }
@@ -616,14 +976,29 @@ void edgex_rest_server_destroy (edgex_rest_server *svr)
   {
     MHD_stop_daemon (svr->daemon);
   }
+  route_free (&svr->routes);
   while (svr->handlers)
   {
     tmp = svr->handlers->next;
     devsdk_strings_free (svr->handlers->url);
+    for (unsigned i = 0; i < 2; i++)
+    {
+      free (svr->handlers->precomp[i].src);
+      free (svr->handlers->precomp[i].data);
+      pthread_mutex_destroy (&svr->handlers->precomp[i].mtx);
+    }
     free (svr->handlers);
     svr->handlers = tmp;
   }
   pthread_mutex_destroy (&svr->lock);
+  while (svr->ctxpool)
+  {
+    http_context_t *ctx = svr->ctxpool;
+    svr->ctxpool = ctx->next;
+    free (ctx->m_data);
+    free (ctx);
+  }
+  pthread_mutex_destroy (&svr->poollock);
   if (svr->cors.enabled)
   {
     for (char **c = svr->cors.allowmethods_parsed; *c; c++)
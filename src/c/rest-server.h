@@ -14,7 +14,19 @@
 struct edgex_rest_server;
 typedef struct edgex_rest_server edgex_rest_server;
 
-extern edgex_rest_server *edgex_rest_server_create (iot_logger_t *lc, const char *bindaddr, uint16_t port, uint64_t maxsize, devsdk_error *err);
+typedef struct edgex_rest_server_options
+{
+  uint64_t maxsize;          // largest request accepted, zero for no limit
+  bool pooled;               // serve from a fixed pool of polling threads rather than a thread per connection
+  uint32_t threads;          // size of the pool when pooled
+  uint32_t maxconns;         // limit on concurrent connections, zero for the libmicrohttpd default
+  uint32_t maxconnsperip;    // limit on concurrent connections from one address, zero for no limit
+  size_t compressmin;        // smallest reply to compress when the client accepts it, zero to disable
+  int compresslevel;         // zlib compression level
+} edgex_rest_server_options;
+
+extern edgex_rest_server *edgex_rest_server_create
+  (iot_logger_t *lc, const char *bindaddr, uint16_t port, const edgex_rest_server_options *opts, devsdk_error *err);
 
 extern void edgex_rest_server_enable_cors
   (edgex_rest_server *svr, const char *origin, const char *methods, const char *headers, const char *expose, bool creds, int64_t maxage);
@@ -24,10 +24,12 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <pthread.h>
 #include "errorlist.h"
 #include "correlation.h"
 #include "rest.h"
 #include "edgex/rest-server.h"
+#include "iot/time.h"
 
 #if (LIBCURL_VERSION_NUM >= 0x073800)
 #define USE_CURL_MIME
@@ -36,6 +38,243 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define MAX_TOKEN_LEN 600
 #define EDGEX_AUTH_HDR "Authorization: Bearer "
 
+/* Easy handles are kept for reuse once a request completes, in a pool for each endpoint (scheme,
+   host and port) of up to EDGEX_CURL_POOLMAX handles. Each handle's own connection cache holds
+   its kept-alive connection, so taking a handle from the endpoint's pool picks that connection
+   up. Handles left unused for EDGEX_CURL_IDLEMAX seconds are discarded. The DNS and TLS session
+   caches are shared between all handles; libcurl does not support sharing connections between
+   handles used concurrently */
+
+#define EDGEX_CURL_POOLMAX 16
+#define EDGEX_CURL_IDLEMAX 60
+
+typedef struct edgex_curl_idle
+{
+  CURL *hnd;
+  uint64_t since;
+} edgex_curl_idle;
+
+typedef struct edgex_curl_endpoint
+{
+  char *key;
+  edgex_curl_idle idle[EDGEX_CURL_POOLMAX];  // oldest first
+  unsigned nidle;
+  struct edgex_curl_endpoint *next;
+} edgex_curl_endpoint;
+
+typedef struct edgex_curl_pool_t
+{
+  CURLSH *share;
+  pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+  pthread_mutex_t mtx;
+  edgex_curl_endpoint *endpoints;
+  unsigned users;
+  atomic_uint_fast64_t created;
+  atomic_uint_fast64_t reused;
+  atomic_uint_fast64_t evicted;
+} edgex_curl_pool_t;
+
+static edgex_curl_pool_t curl_pool = { .mtx = PTHREAD_MUTEX_INITIALIZER };
+static pthread_once_t curl_pool_once = PTHREAD_ONCE_INIT;
+
+static void edgex_curl_lock (CURL *hnd, curl_lock_data data, curl_lock_access access, void *userp)
+{
+  pthread_mutex_lock (&curl_pool.locks[data]);
+}
+
+static void edgex_curl_unlock (CURL *hnd, curl_lock_data data, void *userp)
+{
+  pthread_mutex_unlock (&curl_pool.locks[data]);
+}
+
+static void edgex_curl_locks_init (void)
+{
+  for (unsigned i = 0; i < CURL_LOCK_DATA_LAST; i++)
+  {
+    pthread_mutex_init (&curl_pool.locks[i], NULL);
+  }
+}
+
+/* Create the share if need be. Called with the pool lock held */
+
+static CURLSH *edgex_curl_share (void)
+{
+  if (curl_pool.share == NULL)
+  {
+    pthread_once (&curl_pool_once, edgex_curl_locks_init);
+    curl_pool.share = curl_share_init ();
+    curl_share_setopt (curl_pool.share, CURLSHOPT_LOCKFUNC, edgex_curl_lock);
+    curl_share_setopt (curl_pool.share, CURLSHOPT_UNLOCKFUNC, edgex_curl_unlock);
+    curl_share_setopt (curl_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt (curl_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  }
+  return curl_pool.share;
+}
+
+/* Find the pool for the endpoint of a URL, optionally creating it. Called with the pool lock held */
+
+static edgex_curl_endpoint *edgex_curl_endpoint_find (const char *url, bool create)
+{
+  const char *host = strstr (url, "://");
+  size_t len = host ? (host + 3 - url) + strcspn (host + 3, "/?#") : strlen (url);
+  edgex_curl_endpoint *ep;
+
+  for (ep = curl_pool.endpoints; ep; ep = ep->next)
+  {
+    if (strncmp (ep->key, url, len) == 0 && ep->key[len] == '\0')
+    {
+      return ep;
+    }
+  }
+  if (create)
+  {
+    ep = calloc (1, sizeof (edgex_curl_endpoint));
+    ep->key = strndup (url, len);
+    ep->next = curl_pool.endpoints;
+    curl_pool.endpoints = ep;
+  }
+  return ep;
+}
+
+/* Take the most recently used handle from the pool for a URL's endpoint, or create one */
+
+static CURL *edgex_curl_get (const char *url)
+{
+  CURL *hnd = NULL;
+  CURLSH *share;
+
+  pthread_mutex_lock (&curl_pool.mtx);
+  share = edgex_curl_share ();
+  edgex_curl_endpoint *ep = edgex_curl_endpoint_find (url, false);
+  if (ep && ep->nidle)
+  {
+    hnd = ep->idle[--ep->nidle].hnd;
+  }
+  pthread_mutex_unlock (&curl_pool.mtx);
+
+  if (hnd)
+  {
+    atomic_fetch_add (&curl_pool.reused, 1);
+  }
+  else
+  {
+    hnd = curl_easy_init ();
+    atomic_fetch_add (&curl_pool.created, 1);
+  }
+  curl_easy_setopt (hnd, CURLOPT_SHARE, share);
+  return hnd;
+}
+
+/* Return a handle to its endpoint's pool, discarding any which have been idle too long */
+
+static void edgex_curl_put (const char *url, CURL *hnd)
+{
+  edgex_curl_endpoint *ep;
+  CURL **evict = NULL;
+  unsigned nevict = 0;
+  unsigned size = 0;
+  uint64_t now = iot_time_secs ();
+
+  curl_easy_reset (hnd);
+
+  pthread_mutex_lock (&curl_pool.mtx);
+  for (ep = curl_pool.endpoints; ep; ep = ep->next)
+  {
+    unsigned n = 0;
+    while (n < ep->nidle && ep->idle[n].since + EDGEX_CURL_IDLEMAX < now)
+    {
+      n++;
+    }
+    if (n)
+    {
+      if (nevict + n > size)
+      {
+        size = nevict + n + EDGEX_CURL_POOLMAX;
+        evict = realloc (evict, size * sizeof (CURL *));
+      }
+      for (unsigned i = 0; i < n; i++)
+      {
+        evict[nevict++] = ep->idle[i].hnd;
+      }
+      ep->nidle -= n;
+      memmove (ep->idle, ep->idle + n, ep->nidle * sizeof (edgex_curl_idle));
+    }
+  }
+  ep = edgex_curl_endpoint_find (url, true);
+  if (ep->nidle < EDGEX_CURL_POOLMAX)
+  {
+    ep->idle[ep->nidle].hnd = hnd;
+    ep->idle[ep->nidle++].since = now;
+    hnd = NULL;
+  }
+  pthread_mutex_unlock (&curl_pool.mtx);
+
+  for (unsigned i = 0; i < nevict; i++)
+  {
+    curl_easy_cleanup (evict[i]);
+  }
+  free (evict);
+  if (hnd)
+  {
+    curl_easy_cleanup (hnd);
+    nevict++;
+  }
+  atomic_fetch_add (&curl_pool.evicted, nevict);
+}
+
+void edgex_http_init (void)
+{
+  pthread_mutex_lock (&curl_pool.mtx);
+  curl_pool.users++;
+  pthread_mutex_unlock (&curl_pool.mtx);
+}
+
+void edgex_http_fini (void)
+{
+  edgex_curl_endpoint *list = NULL;
+  CURLSH *share = NULL;
+
+  pthread_mutex_lock (&curl_pool.mtx);
+  if (curl_pool.users && --curl_pool.users == 0)
+  {
+    list = curl_pool.endpoints;
+    curl_pool.endpoints = NULL;
+    share = curl_pool.share;
+    curl_pool.share = NULL;
+  }
+  pthread_mutex_unlock (&curl_pool.mtx);
+
+  while (list)
+  {
+    edgex_curl_endpoint *ep = list;
+    list = ep->next;
+    for (unsigned i = 0; i < ep->nidle; i++)
+    {
+      curl_easy_cleanup (ep->idle[i].hnd);
+    }
+    free (ep->key);
+    free (ep);
+  }
+  if (share)
+  {
+    curl_share_cleanup (share);
+  }
+}
+
+void edgex_http_poolstats (edgex_http_poolstats_t *stats)
+{
+  stats->idle = 0;
+  pthread_mutex_lock (&curl_pool.mtx);
+  for (const edgex_curl_endpoint *ep = curl_pool.endpoints; ep; ep = ep->next)
+  {
+    stats->idle += ep->nidle;
+  }
+  pthread_mutex_unlock (&curl_pool.mtx);
+  stats->created = atomic_load (&curl_pool.created);
+  stats->reused = atomic_load (&curl_pool.reused);
+  stats->evicted = atomic_load (&curl_pool.evicted);
+}
+
 /* Add a request header to the list */
 
 static struct curl_slist *edgex_add_hdr (struct curl_slist *slist, const char *name, const char *value)
@@ -155,8 +394,8 @@ static int abort_callback (void *clientp, curl_off_t dltotal, curl_off_t dlnow,
 }
 
 /*
- * Set up common curl options and headers, perform the http request, process the results and clean up.
- * Additional options may be set by calling curl_easy_setopt before this.
+ * Set up common curl options and headers, perform the http request, process the results and return
+ * the handle to the pool. Additional options may be set by calling curl_easy_setopt before this.
  * Extra headers may be added by passing non-null slist_in.
  */
 
@@ -288,7 +527,7 @@ static long edgex_run_curl
     *err = EDGEX_HTTP_ERROR;
   }
 
-  curl_easy_cleanup (hnd);
+  edgex_curl_put (url, hnd);
   curl_slist_free_all (slist);
   return http_code;
 }
@@ -296,7 +535,7 @@ static long edgex_run_curl
 long edgex_http_get (iot_logger_t *lc, edgex_ctx *ctx, const char *url, void *writefunc, devsdk_error *err)
 {
   long res;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
 
   res = edgex_run_curl (lc, ctx, hnd, url, writefunc, NULL, err);
   iot_log_trace (lc, "GET to %s returns %ld%s%s", url, res, ctx->buff ? ", data " : " (no data)", ctx->buff ? ctx->buff : "");
@@ -306,7 +545,7 @@ long edgex_http_get (iot_logger_t *lc, edgex_ctx *ctx, const char *url, void *wr
 long edgex_http_delete (iot_logger_t *lc, edgex_ctx *ctx, const char *url, void *writefunc, devsdk_error *err)
 {
   long res;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
   curl_easy_setopt (hnd, CURLOPT_CUSTOMREQUEST, "DELETE");
 
   res = edgex_run_curl (lc, ctx, hnd, url, writefunc, NULL, err);
@@ -319,7 +558,7 @@ long edgex_http_post
 {
   long res;
   struct curl_slist *slist;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
 
   curl_easy_setopt (hnd, CURLOPT_CUSTOMREQUEST, "POST");
   curl_easy_setopt (hnd, CURLOPT_POST, 1L);
@@ -335,7 +574,7 @@ long edgex_http_postbin
   (iot_logger_t *lc, edgex_ctx *ctx, const char *url, void *data, size_t length, const char *mime, void *writefunc, devsdk_error *err)
 {
   struct curl_slist *slist;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
 
   curl_easy_setopt (hnd, CURLOPT_CUSTOMREQUEST, "POST");
   curl_easy_setopt (hnd, CURLOPT_POST, 1L);
@@ -359,7 +598,7 @@ long edgex_http_postfile
   struct curl_httppost *lastptr = NULL;
 #endif
 
-  hnd = curl_easy_init ();
+  hnd = edgex_curl_get (url);
 
 #ifdef USE_CURL_MIME
   form = curl_mime_init (hnd);
@@ -419,7 +658,7 @@ long edgex_http_put
 {
   struct curl_slist *slist;
   struct put_data cb_data;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
 
   curl_easy_setopt(hnd, CURLOPT_UPLOAD, 1L);
 
@@ -443,7 +682,7 @@ long edgex_http_patch
   long res;
   struct curl_slist *slist;
   struct put_data cb_data;
-  CURL *hnd = curl_easy_init ();
+  CURL *hnd = edgex_curl_get (url);
 
   curl_easy_setopt (hnd, CURLOPT_CUSTOMREQUEST, "PATCH");
   curl_easy_setopt (hnd, CURLOPT_UPLOAD, 1L);
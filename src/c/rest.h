@@ -75,4 +75,20 @@ long edgex_http_put
 long edgex_http_patch
   (iot_logger_t *lc, edgex_ctx *ctx, const char *url, const char *data, void *writefunc, devsdk_error *err);
 
+/* Usage counts for the pool of curl handles shared by the above functions */
+
+typedef struct edgex_http_poolstats_t
+{
+  uint64_t created;       // handles created
+  uint64_t reused;        // requests which reused a pooled handle
+  uint64_t evicted;       // handles discarded after being idle too long, or with the pool full
+  unsigned idle;          // handles currently in the pool
+} edgex_http_poolstats_t;
+
+void edgex_http_poolstats (edgex_http_poolstats_t *stats);
+
+/* Each service holds the HTTP client pool; when the last is freed, pooled handles and the shared caches are released */
+void edgex_http_init (void);
+void edgex_http_fini (void);
+
 #endif
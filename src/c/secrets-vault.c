@@ -11,8 +11,15 @@
 #include "edgex-rest.h"
 #include "parson.h"
 #include "errorlist.h"
+#include "jwtcache.h"
 #include "iot/scheduler.h"
 
+/* The service's own JWT is renewed once this fraction of its lifetime has passed, or retried
+   after VAULT_JWT_RETRY seconds if renewal fails */
+
+#define VAULT_JWT_RENEW_PCT 80
+#define VAULT_JWT_RETRY 5
+
 typedef struct vault_impl_t
 {
   iot_logger_t *lc;
@@ -28,6 +35,12 @@ typedef struct vault_impl_t
   char *capath;
   bool bearer;
   devsdk_metrics_t *metrics;
+  edgex_jwtcache_t *jwtcache;
+  iot_data_t *jwt;
+  uint64_t jwtexpiry;
+  iot_schedule_t *jwtjob;
+  pthread_rwlock_t jwtlock;
+  pthread_mutex_t jwtmtx;
   pthread_mutex_t mtx;
 } vault_impl_t;
 
@@ -230,6 +243,13 @@ static bool vault_init
   }
   // TODO: SecretStore/ServerName (unsupported in libcurl?)
 
+  vault->jwtcache = edgex_jwtcache_alloc
+  (
+    iot_data_ui32 (iot_data_string_map_get (config, "SecretStore/TokenCacheSize")),
+    iot_data_ui32 (iot_data_string_map_get (config, "SecretStore/TokenRecheckInterval")),
+    m
+  );
+
   vault_schedule_renewal (vault);
   return true;
 }
@@ -286,11 +306,9 @@ static void vault_set (void *impl, const char *path, const iot_data_t *secrets)
   vault_freectx (&ctx);
 }
 
-static iot_data_t * vault_requestjwt (void *impl)
+static iot_data_t *vault_fetchjwt (vault_impl_t *vault)
 {
   iot_data_t *result = NULL;
-  vault_impl_t *vault = (vault_impl_t *)impl;
-  
   iot_data_t *reply = vault_rest_get (vault, vault->jwtissueurl);
   if (reply)
   {
@@ -298,18 +316,124 @@ static iot_data_t * vault_requestjwt (void *impl)
     if (d)
     {
       const iot_data_t *t = iot_data_string_map_get (d, "token");
-      if (t)
+      if (t && iot_data_type (t) == IOT_DATA_STRING)
       {
-        result = iot_data_copy (t);
+        result = iot_data_add_ref (t);
       }
     }
   }
+  iot_data_free (reply);
+  if (result)
+  {
+    atomic_fetch_add (&vault->metrics->jwtrefresh, 1);
+  }
+  else
+  {
+    atomic_fetch_add (&vault->metrics->jwtfail, 1);
+  }
+  return result;
+}
+
+static void *vault_renewjwt (void *v);
+
+/* Called with jwtmtx held */
+
+static void vault_schedule_jwt (vault_impl_t *vault, uint64_t wait)
+{
+  if (vault->jwtjob == NULL)
+  {
+    vault->jwtjob = iot_schedule_create (vault->scheduler, vault_renewjwt, NULL, vault, 0, IOT_SEC_TO_NS (wait ? wait : 1), 1, vault->thpool, -1);
+    iot_schedule_add (vault->scheduler, vault->jwtjob);
+  }
+}
+
+/* Fetch a new JWT and cache it if it carries an expiry time. Called with jwtmtx held. Returns a
+   reference to the new token, or NULL if none could be obtained */
+
+static iot_data_t *vault_updatejwt (vault_impl_t *vault)
+{
+  iot_data_t *old = NULL;
+  iot_data_t *jwt = vault_fetchjwt (vault);
+  uint64_t now = iot_time_secs ();
+
+  if (jwt)
+  {
+    uint64_t expiry = edgex_jwt_expiry (iot_data_string (jwt));
+    if (expiry > now)
+    {
+      pthread_rwlock_wrlock (&vault->jwtlock);
+      old = vault->jwt;
+      vault->jwt = iot_data_add_ref (jwt);
+      vault->jwtexpiry = expiry;
+      pthread_rwlock_unlock (&vault->jwtlock);
+      vault_schedule_jwt (vault, (expiry - now) * VAULT_JWT_RENEW_PCT / 100);
+    }
+  }
+  else if (vault->jwt)
+  {
+    if (vault->jwtexpiry > now + VAULT_JWT_RETRY)
+    {
+      vault_schedule_jwt (vault, VAULT_JWT_RETRY);
+    }
+    else
+    {
+      pthread_rwlock_wrlock (&vault->jwtlock);
+      old = vault->jwt;
+      vault->jwt = NULL;
+      pthread_rwlock_unlock (&vault->jwtlock);
+    }
+  }
+  iot_data_free (old);
+  return jwt;
+}
+
+static void *vault_renewjwt (void *v)
+{
+  vault_impl_t *vault = (vault_impl_t *)v;
+  pthread_mutex_lock (&vault->jwtmtx);
+  iot_schedule_t *self = vault->jwtjob;
+  vault->jwtjob = NULL;
+  iot_data_t *jwt = vault_updatejwt (vault);
+  pthread_mutex_unlock (&vault->jwtmtx);
+  if (jwt == NULL)
+  {
+    iot_log_warn (vault->lc, "vault: unable to renew JWT");
+  }
+  iot_data_free (jwt);
+  iot_schedule_delete (vault->scheduler, self);
+  return NULL;
+}
+
+static iot_data_t * vault_requestjwt (void *impl)
+{
+  iot_data_t *result = NULL;
+  vault_impl_t *vault = (vault_impl_t *)impl;
+
+  pthread_rwlock_rdlock (&vault->jwtlock);
+  if (vault->jwt)
+  {
+    result = iot_data_add_ref (vault->jwt);
+  }
+  pthread_rwlock_unlock (&vault->jwtlock);
+
+  if (result == NULL)
+  {
+    pthread_mutex_lock (&vault->jwtmtx);
+    if (vault->jwt)
+    {
+      result = iot_data_add_ref (vault->jwt);
+    }
+    else
+    {
+      result = vault_updatejwt (vault);
+    }
+    pthread_mutex_unlock (&vault->jwtmtx);
+  }
   if (result == NULL)
   {
     iot_log_error (vault->lc, "vault: get JWT request failed");
     result = iot_data_alloc_map (IOT_DATA_STRING);
   }
-  iot_data_free (reply);
   return result;
 }
 
@@ -318,6 +442,11 @@ static bool vault_isjwtvalid (void *impl, const char *jwt)
   bool result = false;
   vault_impl_t *vault = (vault_impl_t *)impl;
 
+  if (edgex_jwtcache_check (vault->jwtcache, jwt))
+  {
+    return true;
+  }
+
   iot_data_t * body = iot_data_alloc_map(IOT_DATA_STRING);
   iot_data_string_map_add(body, "token", iot_data_alloc_string(jwt, IOT_DATA_REF));
   char * json = iot_data_to_json (body);
@@ -334,6 +463,10 @@ static bool vault_isjwtvalid (void *impl, const char *jwt)
     result = iot_data_string_map_get_bool (reply, "active", false);
   }
   iot_data_free (reply);
+  if (result)
+  {
+    edgex_jwtcache_add (vault->jwtcache, jwt);
+  }
   return result;
 }
 
@@ -341,6 +474,10 @@ static void vault_fini (void *impl)
 {
   vault_impl_t *vault = (vault_impl_t *)impl;
   pthread_mutex_destroy (&vault->mtx);
+  edgex_jwtcache_free (vault->jwtcache);
+  iot_data_free (vault->jwt);
+  pthread_rwlock_destroy (&vault->jwtlock);
+  pthread_mutex_destroy (&vault->jwtmtx);
   free (vault->baseurl);
   free (vault->regurl);
   free (vault->tokinfourl);
@@ -354,6 +491,8 @@ void *edgex_secrets_vault_alloc ()
 {
   vault_impl_t *vault = calloc (1, sizeof (vault_impl_t));
   pthread_mutex_init (&vault->mtx, NULL);
+  pthread_mutex_init (&vault->jwtmtx, NULL);
+  pthread_rwlock_init (&vault->jwtlock, NULL);
   return vault;
 }
 
@@ -30,6 +30,10 @@
 #include "correlation.h"
 #include "edgex/csdk-defs.h"
 #include "request_auth.h"
+#include "intern.h"
+#include "autoevent.h"
+#include "lastconnected.h"
+#include "opstate.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -302,12 +306,20 @@ devsdk_service_t *devsdk_service_new
   result->watchlist = edgex_watchlist_alloc ();
   result->thpool = iot_threadpool_alloc (POOL_THREADS, 0, -1, -1, result->logger);
   result->scheduler = iot_scheduler_alloc (-1, -1, result->logger);
+  result->aewheel = edgex_aewheel_alloc (result);
+  result->lcwriter = edgex_lcwriter_alloc (result);
+  result->opqueue = edgex_opqueue_alloc (result);
+  edgex_http_init ();
   result->discovery = edgex_device_periodic_discovery_alloc (result->logger, result->scheduler, result->thpool, implfns->discover, impldata);
   atomic_store (&result->metrics.esent, 0);
   atomic_store (&result->metrics.rsent, 0);
   atomic_store (&result->metrics.rcexe, 0);
   atomic_store (&result->metrics.secrq, 0);
   atomic_store (&result->metrics.secsto, 0);
+  atomic_store (&result->metrics.jwthit, 0);
+  atomic_store (&result->metrics.jwtmiss, 0);
+  atomic_store (&result->metrics.jwtrefresh, 0);
+  atomic_store (&result->metrics.jwtfail, 0);
   return result;
 }
 
@@ -338,6 +350,83 @@ static void version_handler (void *ctx, const devsdk_http_request *req, devsdk_h
   reply->code = MHD_HTTP_OK;
 }
 
+static JSON_Value *memory_section (size_t count, size_t bytes)
+{
+  JSON_Value *val = json_value_init_object ();
+  JSON_Object *obj = json_value_get_object (val);
+  json_object_set_uint (obj, "count", count);
+  json_object_set_uint (obj, "bytes", bytes);
+  return val;
+}
+
+static void memory_handler (void *ctx, const devsdk_http_request *req, devsdk_http_reply *reply)
+{
+  devsdk_service_t *svc = (devsdk_service_t *) ctx;
+  edgex_devmap_memstats dstats;
+  edgex_intern_stats istats;
+
+  edgex_devmap_memory (svc->devices, &dstats);
+  edgex_intern_getstats (&istats);
+
+  JSON_Value *val = json_value_init_object ();
+  JSON_Object *obj = json_value_get_object (val);
+  json_object_set_string (obj, "apiVersion", EDGEX_API_VERSION);
+  json_object_set_uint (obj, "statusCode", MHD_HTTP_OK);
+  json_object_set_string (obj, "serviceName", svc->name);
+  json_object_set_value (obj, "devices", memory_section (dstats.devices, dstats.devicebytes));
+  json_object_set_value (obj, "autoEvents", memory_section (dstats.autoevents, dstats.autoeventbytes));
+  json_object_set_value (obj, "profiles", memory_section (dstats.profiles, dstats.profilebytes));
+  JSON_Value *nval = memory_section (istats.strings, istats.bytes);
+  json_object_set_uint (json_value_get_object (nval), "saved", istats.saved);
+  json_object_set_value (obj, "names", nval);
+  json_object_set_uint (obj, "total", dstats.devicebytes + dstats.autoeventbytes + dstats.profilebytes + istats.bytes);
+  char *json = json_serialize_to_string (val);
+  json_value_free (val);
+  reply->data.bytes = json;
+  reply->data.size = strlen (json);
+  reply->content_type = CONTENT_JSON;
+  reply->code = MHD_HTTP_OK;
+}
+
+static void autoevent_stats_add (void *ctx, const edgex_device *dev, const edgex_device_autoevents *ae)
+{
+  edgex_autoevent_stats stats;
+  if (edgex_device_autoevent_stats (ae, &stats))
+  {
+    JSON_Value *val = json_value_init_object ();
+    JSON_Object *obj = json_value_get_object (val);
+    json_object_set_string (obj, "deviceName", dev->name);
+    json_object_set_string (obj, "sourceName", ae->resource);
+    json_object_set_string (obj, "interval", ae->interval);
+    json_object_set_uint (obj, "overruns", stats.overruns);
+    json_object_set_uint (obj, "skipped", stats.skipped);
+    json_object_set_uint (obj, "maxRuntime", stats.maxruntime / 1000000);
+    json_object_set_uint (obj, "backoff", stats.stretch);
+    json_object_set_boolean (obj, "inFlight", stats.inflight);
+    json_array_append_value ((JSON_Array *)ctx, val);
+  }
+}
+
+static void autoevents_handler (void *ctx, const devsdk_http_request *req, devsdk_http_reply *reply)
+{
+  devsdk_service_t *svc = (devsdk_service_t *) ctx;
+
+  JSON_Value *val = json_value_init_object ();
+  JSON_Object *obj = json_value_get_object (val);
+  JSON_Value *aval = json_value_init_array ();
+  edgex_devmap_autoevents (svc->devices, autoevent_stats_add, json_value_get_array (aval));
+  json_object_set_string (obj, "apiVersion", EDGEX_API_VERSION);
+  json_object_set_uint (obj, "statusCode", MHD_HTTP_OK);
+  json_object_set_string (obj, "serviceName", svc->name);
+  json_object_set_value (obj, "autoEvents", aval);
+  char *json = json_serialize_to_string (val);
+  json_value_free (val);
+  reply->data.bytes = json;
+  reply->data.size = strlen (json);
+  reply->content_type = CONTENT_JSON;
+  reply->code = MHD_HTTP_OK;
+}
+
 extern void devsdk_publish_system_event (devsdk_service_t *svc, const char *action, iot_data_t * details)
 {
   iot_data_t *event;
@@ -381,17 +470,18 @@ extern void devsdk_publish_discovery_event (devsdk_service_t *svc, const char *
   iot_data_free (event);
 }
 
-static void devsdk_publish_metric (devsdk_service_t *svc, const char *mname, uint64_t val)
+static iot_data_t *devsdk_metric_field (const char *fname, iot_data_t *val)
+{
+  iot_data_t *field = iot_data_alloc_map (IOT_DATA_STRING);
+  iot_data_string_map_add (field, "name", iot_data_alloc_string (fname, IOT_DATA_REF));
+  iot_data_string_map_add (field, "value", val);
+  return field;
+}
+
+static void devsdk_publish_fields (devsdk_service_t *svc, const char *mname, iot_data_t *fields)
 {
-  iot_data_t *field;
-  iot_data_t *fields;
   iot_data_t *metric;
 
-  field = iot_data_alloc_map (IOT_DATA_STRING);
-  iot_data_string_map_add (field, "name", iot_data_alloc_string ("counter-count", IOT_DATA_REF));
-  iot_data_string_map_add (field, "value", iot_data_alloc_ui64 (val));
-  fields = iot_data_alloc_vector (1);
-  iot_data_vector_add (fields, 0, field);
   metric = iot_data_alloc_map (IOT_DATA_STRING);
   iot_data_string_map_add (metric, "apiVersion", iot_data_alloc_string (EDGEX_API_VERSION, IOT_DATA_REF));
   iot_data_string_map_add (metric, "name", iot_data_alloc_string (mname, IOT_DATA_REF));
@@ -405,6 +495,61 @@ static void devsdk_publish_metric (devsdk_service_t *svc, const char *mname, uin
   iot_data_free (metric);
 }
 
+static void devsdk_publish_metric (devsdk_service_t *svc, const char *mname, uint64_t val)
+{
+  iot_data_t *fields = iot_data_alloc_vector (1);
+  iot_data_vector_add (fields, 0, devsdk_metric_field ("counter-count", iot_data_alloc_ui64 (val)));
+  devsdk_publish_fields (svc, mname, fields);
+}
+
+static void devsdk_publish_aeload (devsdk_service_t *svc)
+{
+  double mean;
+  unsigned peak;
+  edgex_aewheel_load (svc->aewheel, &mean, &peak);
+  iot_data_t *fields = iot_data_alloc_vector (4);
+  iot_data_vector_add (fields, 0, devsdk_metric_field ("tick-mean", iot_data_alloc_f64 (mean)));
+  iot_data_vector_add (fields, 1, devsdk_metric_field ("tick-max", iot_data_alloc_ui32 (peak)));
+  iot_data_vector_add (fields, 2, devsdk_metric_field ("skipped", iot_data_alloc_ui64 (atomic_load (&svc->metrics.aeskip))));
+  iot_data_vector_add (fields, 3, devsdk_metric_field ("overruns", iot_data_alloc_ui64 (atomic_load (&svc->metrics.aeoverrun))));
+  devsdk_publish_fields (svc, "AutoEventTickLoad", fields);
+}
+
+static void devsdk_publish_jwtcache (devsdk_service_t *svc)
+{
+  iot_data_t *fields = iot_data_alloc_vector (4);
+  iot_data_vector_add (fields, 0, devsdk_metric_field ("hits", iot_data_alloc_ui64 (atomic_load (&svc->metrics.jwthit))));
+  iot_data_vector_add (fields, 1, devsdk_metric_field ("misses", iot_data_alloc_ui64 (atomic_load (&svc->metrics.jwtmiss))));
+  iot_data_vector_add (fields, 2, devsdk_metric_field ("refreshes", iot_data_alloc_ui64 (atomic_load (&svc->metrics.jwtrefresh))));
+  iot_data_vector_add (fields, 3, devsdk_metric_field ("refresh-failures", iot_data_alloc_ui64 (atomic_load (&svc->metrics.jwtfail))));
+  devsdk_publish_fields (svc, "SecurityTokenCache", fields);
+}
+
+static void devsdk_publish_httppool (devsdk_service_t *svc)
+{
+  edgex_http_poolstats_t stats;
+  edgex_http_poolstats (&stats);
+  iot_data_t *fields = iot_data_alloc_vector (4);
+  iot_data_vector_add (fields, 0, devsdk_metric_field ("created", iot_data_alloc_ui64 (stats.created)));
+  iot_data_vector_add (fields, 1, devsdk_metric_field ("reused", iot_data_alloc_ui64 (stats.reused)));
+  iot_data_vector_add (fields, 2, devsdk_metric_field ("evicted", iot_data_alloc_ui64 (stats.evicted)));
+  iot_data_vector_add (fields, 3, devsdk_metric_field ("idle", iot_data_alloc_ui32 (stats.idle)));
+  devsdk_publish_fields (svc, "HttpClientPool", fields);
+}
+
+static void devsdk_publish_lcupdates (devsdk_service_t *svc)
+{
+  edgex_lcwriter_stats stats;
+  edgex_lcwriter_getstats (svc->lcwriter, &stats);
+  iot_data_t *fields = iot_data_alloc_vector (5);
+  iot_data_vector_add (fields, 0, devsdk_metric_field ("flushes", iot_data_alloc_ui64 (stats.flushes)));
+  iot_data_vector_add (fields, 1, devsdk_metric_field ("updates", iot_data_alloc_ui64 (stats.updates)));
+  iot_data_vector_add (fields, 2, devsdk_metric_field ("batch-max", iot_data_alloc_ui32 (stats.maxbatch)));
+  iot_data_vector_add (fields, 3, devsdk_metric_field ("latency-mean", iot_data_alloc_f64 (stats.flushes ? stats.latency / 1e6 / stats.flushes : 0.0)));
+  iot_data_vector_add (fields, 4, devsdk_metric_field ("latency-max", iot_data_alloc_f64 (stats.maxlatency / 1e6)));
+  devsdk_publish_fields (svc, "LastConnectedUpdates", fields);
+}
+
 static void *devsdk_run_metrics (void *p)
 {
   devsdk_service_t *svc = (devsdk_service_t *)p;
@@ -415,6 +560,10 @@ static void *devsdk_run_metrics (void *p)
   if (svc->config.metrics.flags & EX_METRIC_RDCMDS) devsdk_publish_metric (svc, "ReadCommandsExecuted", atomic_load (&svc->metrics.rcexe));
   if (svc->config.metrics.flags & EX_METRIC_SECREQ) devsdk_publish_metric (svc, "SecuritySecretsRequested", atomic_load (&svc->metrics.secrq));
   if (svc->config.metrics.flags & EX_METRIC_SECSTO) devsdk_publish_metric (svc, "SecuritySecretsStored", atomic_load (&svc->metrics.secsto));
+  if (svc->config.metrics.flags & EX_METRIC_AELOAD) devsdk_publish_aeload (svc);
+  if (svc->config.metrics.flags & EX_METRIC_JWTCACHE) devsdk_publish_jwtcache (svc);
+  if (svc->config.metrics.flags & EX_METRIC_HTTPPOOL) devsdk_publish_httppool (svc);
+  if (svc->config.metrics.flags & EX_METRIC_LCUPDATE) devsdk_publish_lcupdates (svc);
   edgex_device_free_crlid ();
 
   return NULL;
@@ -700,10 +849,29 @@ static void startConfigured (devsdk_service_t *svc, const devsdk_timeout *deadli
   edgex_devmap_populate_devices (svc->devices, devs);
   edgex_device_free (svc, devs);
 
+  edgex_intern_stats istats;
+  edgex_intern_getstats (&istats);
+  iot_log_info
+  (
+    svc->logger,
+    "Interned %zu names (%zu bytes, %zu references), saving %zu bytes",
+    istats.strings, istats.bytes, istats.refs, istats.saved
+  );
+
   /* Start REST server now so that we get the callbacks on device addition */
 
   const char *bindaddr = strlen (svc->config.service.bindaddr) ? svc->config.service.bindaddr : svc->config.service.host;
-  svc->daemon = edgex_rest_server_create (svc->logger, bindaddr, svc->config.service.port, svc->config.service.maxreqsz, err);
+  edgex_rest_server_options opts =
+  {
+    .maxsize = svc->config.service.maxreqsz,
+    .pooled = svc->config.service.serverpool,
+    .threads = svc->config.service.serverthreads,
+    .maxconns = svc->config.service.maxconns,
+    .maxconnsperip = svc->config.service.maxconnsperip,
+    .compressmin = svc->config.service.compressmin,
+    .compresslevel = svc->config.service.compresslevel
+  };
+  svc->daemon = edgex_rest_server_create (svc->logger, bindaddr, svc->config.service.port, &opts, err);
   if (err->code)
   {
     return;
@@ -764,6 +932,8 @@ static void startConfigured (devsdk_service_t *svc, const devsdk_timeout *deadli
   /* Start scheduled events */
 
   iot_scheduler_start (svc->scheduler);
+  edgex_aewheel_start (svc->aewheel);
+  edgex_lcwriter_start (svc->lcwriter);
 
   /* Register MessageBus handlers */
 
@@ -819,6 +989,12 @@ static void startConfigured (devsdk_service_t *svc, const devsdk_timeout *deadli
 
     svc->version_wrapper = (auth_wrapper_t){ svc, svc->secretstore, version_handler};
     edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API_VERSION, DevSDK_Get, &svc->version_wrapper, http_auth_wrapper);
+
+    svc->memory_wrapper = (auth_wrapper_t){ svc, svc->secretstore, memory_handler};
+    edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API3_MEMORY, DevSDK_Get, &svc->memory_wrapper, http_auth_wrapper);
+
+    svc->autoevents_wrapper = (auth_wrapper_t){ svc, svc->secretstore, autoevents_handler};
+    edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API3_AUTOEVENTS, DevSDK_Get, &svc->autoevents_wrapper, http_auth_wrapper);
   }
   else
   {
@@ -833,6 +1009,10 @@ static void startConfigured (devsdk_service_t *svc, const devsdk_timeout *deadli
     edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API3_SECRET, DevSDK_Post, svc, edgex_device_handler_secret);
 
     edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API_VERSION, DevSDK_Get, svc, version_handler);
+
+    edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API3_MEMORY, DevSDK_Get, svc, memory_handler);
+
+    edgex_rest_server_register_handler (svc->daemon, EDGEX_DEV_API3_AUTOEVENTS, DevSDK_Get, svc, autoevents_handler);
   }
 
   // No auth wrapper for ping (required for health check)
@@ -1117,62 +1297,6 @@ void devsdk_register_http_handler
   }
 }
 
-void devsdk_post_readings
-(
-  devsdk_service_t *svc,
-  const char *devname,
-  const char *resname,
-  devsdk_commandresult *values
-)
-{
-  if (svc->adminstate == LOCKED)
-  {
-    iot_log_debug (svc->logger, "Post readings: dropping event as service is locked");
-    return;
-  }
-
-  edgex_device *dev = edgex_devmap_device_byname (svc->devices, devname);
-  if (dev == NULL)
-  {
-    iot_log_error (svc->logger, "Post readings: no such device %s", devname);
-    return;
-  }
-
-  const edgex_cmdinfo *command = edgex_deviceprofile_findcommand (svc, resname, dev->profile, true);
-  edgex_device_release (svc, dev);
-
-  if (command)
-  {
-    edgex_event_cooked *event = edgex_data_process_event
-      (devname, command, values, svc->config.device.datatransform);
-
-    if (event)
-    {
-      edgex_device_alloc_crlid (NULL);
-      if (svc->config.device.maxeventsize && edgex_event_cooked_size (event) > svc->config.device.maxeventsize * 1024)
-      {
-        iot_log_error (svc->logger, "Post readings: Event size (%zu KiB) exceeds configured MaxEventSize", edgex_event_cooked_size (event) / 1024);
-      }
-      else
-      {
-        edgex_data_client_add_event (svc->msgbus, event, &svc->metrics);
-      }
-
-      if (svc->config.device.updatelastconnected)
-      {
-        devsdk_error err = EDGEX_OK;
-        edgex_metadata_client_update_lastconnected (svc->logger, &svc->config.endpoints, svc->secretstore, devname, &err);
-      }
-      edgex_device_free_crlid();
-      edgex_event_cooked_free (event);
-    }
-  }
-  else
-  {
-    iot_log_error (svc->logger, "Post readings: no such resource %s", resname);
-  }
-}
-
 iot_data_t *devsdk_get_secrets (devsdk_service_t *svc, const char *path)
 {
   return edgex_secrets_get (svc->secretstore, path);
@@ -1202,6 +1326,10 @@ void devsdk_service_stop (devsdk_service_t *svc, bool force, devsdk_error *err)
   {
     iot_scheduler_stop (svc->scheduler);
   }
+  if (svc->aewheel)
+  {
+    edgex_aewheel_stop (svc->aewheel);
+  }
   if (svc->registry)
   {
     devsdk_registry_deregister_service (svc->registry, svc->name, err);
@@ -1212,6 +1340,14 @@ void devsdk_service_stop (devsdk_service_t *svc, bool force, devsdk_error *err)
   }
   iot_threadpool_wait (svc->eventq);
   iot_threadpool_wait (svc->thpool);
+  if (svc->lcwriter)
+  {
+    edgex_lcwriter_stop (svc->lcwriter);
+  }
+  if (svc->opqueue)
+  {
+    edgex_opqueue_stop (svc->opqueue);
+  }
   svc->userfns.stop (svc->userdata, force);
   edgex_devmap_clear (svc->devices);
   iot_log_info (svc->logger, "Stopped device service");
@@ -1222,7 +1358,10 @@ void devsdk_service_free (devsdk_service_t *svc)
   if (svc)
   {
     iot_scheduler_free (svc->scheduler);
+    edgex_lcwriter_free (svc->lcwriter);
+    edgex_opqueue_free (svc->opqueue);
     edgex_devmap_free (svc->devices);
+    edgex_aewheel_free (svc->aewheel);
     edgex_bus_free (svc->msgbus);
     edgex_watchlist_free (svc->watchlist);
     edgex_device_periodic_discovery_free (svc->discovery);
@@ -1230,6 +1369,7 @@ void devsdk_service_free (devsdk_service_t *svc)
     iot_threadpool_free (svc->eventq);
     devsdk_registry_free (svc->registry);
     edgex_secrets_fini (svc->secretstore);
+    edgex_http_fini ();
     iot_logger_free (svc->logger);
     edgex_device_freeConfig (svc);
     free (svc->stopconfig);
@@ -22,6 +22,13 @@
 #include "iot/scheduler.h"
 #include "request_auth.h"
 
+struct edgex_aewheel;
+typedef struct edgex_aewheel edgex_aewheel;
+struct edgex_lcwriter;
+typedef struct edgex_lcwriter edgex_lcwriter;
+struct edgex_opqueue;
+typedef struct edgex_opqueue edgex_opqueue;
+
 struct devsdk_callbacks
 {
   devsdk_initialize init;
@@ -42,6 +49,10 @@ struct devsdk_callbacks
   devsdk_autoevent_start_handler ae_starter;
   devsdk_autoevent_stop_handler ae_stopper;
   devsdk_validate_address validate_addr;
+  devsdk_connection_key conn_key;
+  devsdk_handle_get_batch get_batch;
+  devsdk_handle_get_async get_async;
+  devsdk_handle_put_async put_async;
 };
 
 struct devsdk_service_t
@@ -76,6 +87,9 @@ struct devsdk_service_t
   iot_threadpool_t *thpool;
   iot_threadpool_t *eventq;
   iot_scheduler_t *scheduler;
+  edgex_aewheel *aewheel;
+  edgex_lcwriter *lcwriter;
+  edgex_opqueue *opqueue;
 
   auth_wrapper_t callback_profile_wrapper;
   auth_wrapper_t callback_watcher_wrapper;
@@ -87,6 +101,8 @@ struct devsdk_service_t
   auth_wrapper_t config_wrapper;
   auth_wrapper_t secret_wrapper;
   auth_wrapper_t version_wrapper;
+  auth_wrapper_t memory_wrapper;
+  auth_wrapper_t autoevents_wrapper;
   // Note: no ping_wrapper (intentionally)!
 
 };
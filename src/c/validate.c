@@ -8,6 +8,7 @@
 
 #include "validate.h"
 #include "service.h"
+#include "intern.h"
 
 #include <microhttpd.h>
 
@@ -23,7 +24,7 @@ static devsdk_protocols *protocols_convert (const iot_data_t *obj)
     while (iot_data_map_iter_next (&iter))
     {
       devsdk_protocols *prot = malloc (sizeof (devsdk_protocols));
-      prot->name = strdup (iot_data_map_iter_string_key (&iter));
+      prot->name = edgex_intern (iot_data_map_iter_string_key (&iter));
       prot->properties = iot_data_add_ref (iot_data_map_iter_value (&iter));
       prot->next = result;
       result = prot;